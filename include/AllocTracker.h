@@ -0,0 +1,61 @@
+#ifndef _ALLOCTRACKER_H_
+#define _ALLOCTRACKER_H_
+
+#include <stddef.h>
+
+// Distinct profiler zones allocations can be attributed to
+#define ALLOC_MAX_ZONES 256
+
+// Offending frames remembered for the report
+#define ALLOC_MAX_VIOLATIONS 64
+
+struct AllocFrameStats
+{
+	unsigned long allocs;
+	unsigned long bytes;
+	unsigned long liveBytes;
+
+	// Zone that allocated the most bytes this frame, or nullptr
+	const char* topZone;
+};
+
+///
+/// Heap allocation counters, attributed to the current frame and
+/// to the innermost profiler zone. Only active when built with
+/// -D TRACK_ALLOCS (make TRACK_ALLOCS=true), which replaces the
+/// global operator new/delete and hooks stb_image and glText.
+///
+/// Frames are the frame thread's: the one calling ExpectNoAllocs()
+/// and EndFrame(). Other threads only add to the totals and zones.
+///
+class AllocTracker
+{
+	public:
+		static bool Enabled();
+
+		static void OnAlloc(size_t size);
+		static void OnFree(size_t size);
+
+		// Frames marked this way are reported if they allocate
+		static void ExpectNoAllocs(bool expect);
+
+		// Closes the current frame and starts a new one
+		static AllocFrameStats EndFrame();
+
+		// Frames closed that were expected not to allocate but did
+		static unsigned long Violations();
+
+		// Per-zone totals, peak live bytes and offending frames
+		static bool DumpReport(const char* path);
+};
+
+// Tracked C allocation functions for stb_image and glText
+extern "C"
+{
+	void* TrackedMalloc(size_t size);
+	void* TrackedCalloc(size_t count, size_t size);
+	void* TrackedRealloc(void* ptr, size_t size);
+	void TrackedFree(void* ptr);
+}
+
+#endif // _ALLOCTRACKER_H_
@@ -0,0 +1,66 @@
+#ifndef _ASSETLOADER_H_
+#define _ASSETLOADER_H_
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <SDL_mixer.h>
+
+#include <WorkQueue.h>
+
+// Music and both sound effects decode side by side
+#define ASSET_LOADER_THREADS 3
+
+///
+/// Decodes startup assets on worker threads while the main
+/// thread sets up the window, GL context and shaders. Results are
+/// picked up with the Wait functions, which decode on the calling
+/// thread if the asset was never queued.
+///
+class AssetLoader
+{
+	private:
+		struct Task
+		{
+			std::string path;
+			std::future<void> done;
+			bool collected;
+
+			Mix_Music *music;
+			Mix_Chunk *chunk;
+
+			// Time the worker spent on it
+			uint64_t duration;
+		};
+
+		std::vector<std::unique_ptr<Task>> tasks;
+
+		// Serial cost of every task vs. time the caller spent blocked
+		uint64_t totalWork, totalWaited;
+		uint64_t startTime;
+
+		// Declared after 'tasks', so it drains before they go
+		WorkQueue workers;
+
+		Task* Queue(const char* path, int kind);
+		Task* Wait(const char* path);
+
+	public:
+		AssetLoader();
+		~AssetLoader();
+
+		void QueueMusic(const char* path);
+		void QueueChunk(const char* path);
+
+		Mix_Music* WaitMusic(const char* path);
+		Mix_Chunk* WaitChunk(const char* path);
+
+		// Logs decode time vs. time the main thread actually waited
+		void Report();
+};
+
+#endif // _ASSETLOADER_H_
@@ -0,0 +1,53 @@
+#ifndef _ASSETPACK_H_
+#define _ASSETPACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+///
+/// Single file holding every asset in res/, memory-mapped once at
+/// startup. A header, an index sorted by name for binary search, then
+/// the file contents, each aligned to ASSET_PACK_ALIGNMENT. Assets
+/// are looked up by the same relative path the game would open
+/// ("res/tunnel.bmp"). Built by the packAssets tool (make pack).
+///
+#define ASSET_PACK_MAGIC 0x4b505349 // "ISPK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_NAME_SIZE 48
+#define ASSET_PACK_ALIGNMENT 16
+#define ASSET_PACK_PATH "res.pack"
+
+struct AssetPackHeader
+{
+	uint32_t magic, version;
+	uint32_t count, reserved;
+};
+
+struct AssetPackEntry
+{
+	// Zero padded, always terminated
+	char name[ASSET_PACK_NAME_SIZE];
+
+	// From the start of the file
+	uint64_t offset, size;
+};
+
+class AssetPack
+{
+	public:
+		// Maps the pack. Without one, every lookup misses and
+		// callers fall back to loose files.
+		static bool Open(const char *path);
+		static void Close();
+
+		// Points into the mapping, valid until Close(). Safe to call
+		// from any thread once Open() returned.
+		static bool Find(const char *name, const unsigned char *&data, size_t &size);
+
+		// Offline: packs the given files under their given names
+		static bool Build(const char *path, const std::vector<std::string> &files, std::string &error);
+};
+
+#endif // _ASSETPACK_H_
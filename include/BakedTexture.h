@@ -0,0 +1,47 @@
+#ifndef _BAKEDTEXTURE_H_
+#define _BAKEDTEXTURE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+///
+/// Pre-baked texture format: a header followed by a full RGBA8 mip
+/// chain, level 0 first, tightly packed. Written by the bakeTextures
+/// tool (make bake) next to the source image, as <source>.istx.
+///
+#define BAKED_TEXTURE_MAGIC 0x58545349 // "ISTX"
+#define BAKED_TEXTURE_VERSION 1
+#define BAKED_TEXTURE_MAX_LEVELS 16
+#define BAKED_TEXTURE_EXTENSION ".istx"
+
+struct BakedTextureHeader
+{
+	uint32_t magic, version;
+	uint32_t width, height, levels, reserved;
+
+	// Source image this was baked from, to detect stale files
+	uint64_t sourceSize;
+	int64_t sourceTime;
+
+	// From the start of the file
+	uint64_t levelOffset[BAKED_TEXTURE_MAX_LEVELS];
+};
+
+std::string BakedTexturePath(const char *source);
+
+// One level of an RGBA8 chain from the one above it, with the 2x2 box
+// filter baked chains use. Odd sizes repeat their last row/column.
+void DownsampleTexture(const unsigned char *src, unsigned int srcWidth, unsigned int srcHeight,
+	unsigned char *dst, unsigned int dstWidth, unsigned int dstHeight);
+
+// Decodes the source image and writes its baked version
+bool BakeTexture(const char *source, std::string &error);
+
+// Checks a baked file's contents (mapped, or from the asset pack):
+// header, level bounds and that it matches the source's current size
+// and modification time (when the source exists as a loose file).
+// Returns the header, or nullptr.
+const BakedTextureHeader* ValidateBakedTexture(const unsigned char *data, size_t size, const char *source);
+
+#endif // _BAKEDTEXTURE_H_
@@ -0,0 +1,59 @@
+#ifndef _BATCHRUNNER_H_
+#define _BATCHRUNNER_H_
+
+#include <vector>
+
+#include <stdint.h>
+
+struct BatchOptions
+{
+	unsigned int games;
+
+	// 0 uses every hardware thread
+	unsigned int threads;
+
+	// 1 to 3, or 0 to cycle through all of them
+	unsigned short int difficulty;
+
+	// Tunnel mode, 4, 6 or 8
+	unsigned short int sides;
+
+	// Game i plays a seed derived from this and i
+	uint32_t seed;
+
+	const char *bot;
+
+	// Games still going after this long count as survived
+	uint32_t maxTicks;
+
+	// One line per game, when set
+	const char *csvPath;
+
+	BatchOptions();
+};
+
+struct BatchGame
+{
+	uint32_t seed;
+	unsigned short int difficulty;
+	unsigned int score;
+	uint32_t ticks;
+	bool survived;
+};
+
+///
+/// Plays many headless games on worker threads, each with its own
+/// Simulation and bot, and reports how they went
+///
+class BatchRunner
+{
+	public:
+		// Returns 0 when the bot is unknown or a file can't be written
+		static bool Run(const BatchOptions &options);
+
+	private:
+		static void Report(const BatchOptions &options, const std::vector<BatchGame> &games, unsigned int threads, double seconds);
+		static bool WriteCSV(const char *path, const std::vector<BatchGame> &games);
+};
+
+#endif // _BATCHRUNNER_H_
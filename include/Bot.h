@@ -0,0 +1,31 @@
+#ifndef _BOT_H_
+#define _BOT_H_
+
+#include <stdint.h>
+
+#include <FixedPoint.h>
+#include <ObstacleTrack.h>
+
+///
+/// Plays the game in place of the keyboard. Asked once per tick,
+/// before the simulation steps, for the SIM_INPUT_* bits to hold.
+/// One instance per simulation, never shared between threads.
+///
+class Bot
+{
+	public:
+		virtual ~Bot() {}
+
+		// A new game starts. 'seed' is for bots that want randomness.
+		virtual void Reset(unsigned short int difficulty, uint32_t seed, unsigned short int sides) = 0;
+
+		// 'track' holds the obstacles still ahead, and 'rotation' is
+		// the tunnel's, in degrees
+		virtual int Input(const ObstacleTrack &track, Fixed rotation) = 0;
+};
+
+// "dodge" steers into the nearest open lane of the next obstacle,
+// "random" mashes keys and "idle" never moves. nullptr if unknown.
+Bot* CreateBot(const char* name);
+
+#endif // _BOT_H_
@@ -2,6 +2,7 @@
 #define _ENGINE_H_
 
 #include <iostream>
+#include <memory>
 #include <fstream>
 #include <string>
 
@@ -10,6 +11,13 @@
 #include <GL/gl.h>
 
 #include <Geometry.h>
+#include <AssetLoader.h>
+#include <StutterDetector.h>
+#include <Simulation.h>
+#include <Replay.h>
+#include <Bot.h>
+#include <BatchRunner.h>
+#include <LevelAnalyzer.h>
 
 class Engine
 {
@@ -21,20 +29,70 @@ class Engine
 		Mix_Chunk *gameSelect;
 		const unsigned char* keystate;
 		Uint32 tickStart, tickEnd;
-		std::ofstream logFile;
 		Geometry geometryHandler;
+		AssetLoader assetLoader;
+		StutterDetector stutterDetector;
 
+		// Gameplay, stepped in SIM_TICK_MS ticks by Update()
+		Simulation simulation;
+		Uint32 tickTime;
+
+		// --record: every game is written to <prefix>-<n>.isr
+		InputRecorder recorder;
+		const char* recordPrefix;
+		unsigned int recordedGames;
+
+		// --replay: inputs come from a recording instead of the
+		// keyboard. --headless plays it, or one --bot game, without
+		// window or audio.
+		InputPlayback playback;
+		bool replaying, headless, replayMatched;
+
+		// --bot: plays in place of the keyboard. Given a --difficulty
+		// in a window, it starts one game by itself and quits after it.
+		std::unique_ptr<Bot> bot;
+		bool autoplay;
+
+		// --batch: many headless bot games on worker threads
+		BatchOptions batchOptions;
+		bool batching;
+
+		// --analyze-levels: how often generated obstacle sequences
+		// can't be survived
+		LevelAnalysisOptions analysisOptions;
+		bool analyzing;
+
+		Uint32 FrameTime() const;
 		void Update(Uint32 elapsedTime);
-		int Draw();
+		void Draw();
+		void PlayMusic();
+
+		void StartGame(unsigned short int difficulty, uint32_t seed, unsigned short int sides);
+		void EndGame(bool hit);
+		void SaveRecording();
+		void CheckReplay();
+		bool RunHeadless();
 
 		// 0 - Main menu, 1 - Game over, 2 - Options, 3 - Gameplay
 		unsigned short int gameState;
 
+		// --sides: 4, 6 or 8 sided tunnel
+		unsigned short int tunnelSides;
+
+		// Render metrics overlay, toggled with F3
+		bool showOverlay;
+
+		// Label of a --startup-benchmark run, or nullptr
+		const char* startupBenchmark;
+
+		// --hidden: renders as usual, without showing the window
+		bool hiddenWindow;
+
 	public:
 		bool Initialize(int argc, char *argv[]);
-		void Shutdown();
+		// 0 when a TRACK_ALLOCS build saw gameplay frames allocate
+		bool Shutdown();
 		bool GameLoop();
-		bool Log(std::string msg);
 		bool LoadMedia();
 };
 
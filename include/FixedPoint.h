@@ -0,0 +1,20 @@
+#ifndef _FIXEDPOINT_H_
+#define _FIXEDPOINT_H_
+
+#include <stdint.h>
+
+// Simulation state is kept in thousandths: of a unit for distances,
+// of a degree for angles, of the base speed for speeds. Every
+// constant of the game is exact at this scale, and integer math
+// gives the same results with any compiler, flags or machine.
+#define FIXED_ONE 1000
+
+typedef int32_t Fixed;
+
+// For drawing only, never fed back into the simulation
+inline float FixedToFloat(Fixed x)
+{
+	return x / (float)FIXED_ONE;
+}
+
+#endif // _FIXEDPOINT_H_
@@ -4,13 +4,29 @@
 #define MAX_GEOM 3
 #define MAX_SHADERS 2
 
+// Entries of each difficulty's table listed on the menu
+#define HIGHSCORES_SHOWN 5
+
+// Nothing further away than this is drawn, in units
+#define FAR_PLANE 100
+
+// Vertex inputs, as laid out in res/vertexShader.vert
+#define ATTRIB_VERT 0
+#define ATTRIB_TEXCOORD 1
+#define ATTRIB_NORMAL 2
+
 #include <vector>
 
 #include <SDL.h>
 #include <GL/gl.h>
 #include <glm/glm.hpp>
 
-#include <Obstacle.h>
+#include <Simulation.h>
+#include <ShaderLoader.h>
+#include <TextureResidency.h>
+#include <HighscoreStore.h>
+
+typedef struct GLTtext GLTtext;
 
 struct Light
 {
@@ -24,54 +40,73 @@ class Geometry
 		// Matrixes
 		glm::mat4 modelMatrix, viewMatrix, projectionMatrix, pipelineMatrix;
 
+		// Models that never move, built once: full screen images and
+		// the ship
+		glm::mat4 screenMatrix, shipMatrix;
+
 		// VAOs, VBOs & EBOs
 		GLuint VAO[MAX_GEOM], VBO[MAX_GEOM], EBO[MAX_GEOM];
 
 		// Compiled shader program IDs
 		GLuint shaderProgramID[MAX_SHADERS];
 
+		// Compiling in the background until ShadersReady()
+		ShaderProgramBuild shaderBuilds[MAX_SHADERS];
+		bool shadersReady;
+
+		// Built-in loading screen, drawn meanwhile
+		GLuint loadingProgramID, loadingVAO;
+		GLint loadingProgressID;
+
 		// Holds reference for uniforms inside
 		// the vertex shader.
 		GLuint uniformID[MAX_SHADERS*5];
 
-		// Level obstacles
-		std::vector<Obstacle*> obstacles;
-		
+		// Texture array layer, per program
+		GLint layerUniformID[MAX_SHADERS];
+
 		// Global light
 		Light globalLight;
 
 		// Light effects
 		double hue, brightness;
 
-		// Textures
-		GLuint menuTexture, gameOverTexture, tunnelTexture, obstacleTexture;
+		// Simulation's passed obstacle count, to flash on the next one
+		unsigned int lastPassed;
+
+		// Text, created once and updated in place
+		GLTtext *overlayText, *highscoreText, *scoreText;
 
-		// In degrees
-		double tunnelRotation;
+		// Texture arrays, loaded per screen: one per full screen
+		// image, and one with everything gameplay draws, so it only
+		// binds a texture once
+		TextureResidency textures;
+		unsigned int menuTextures, gameOverTextures, worldTextures;
 
-		// Game difficulty
-		unsigned short int difficulty;
-		double movementSpeed;
+		// Screen drawn last frame, to prefetch on transitions
+		int lastGameState;
 
-		// Score
-		unsigned int score;
-		unsigned int highscores[5];
+		// Per difficulty
+		HighscoreStore highscores;
+
+		// Takes the cosine and sine of the tunnel's rotation
+		template <int Sides>
+		void DrawTunnel(float cosRotation, float sinRotation, const Simulation &simulation);
 
 	public:
 		void InitMatrixes();
 		void InitShaders();
+		bool ShadersReady();
+		void DrawLoading();
+		void QueueTextures();
+		void SetTextureBudget(size_t bytes);
 		void InitGeometry();
 		void InitFonts();
-		void GenerateObstacles(unsigned int number, unsigned int offset);
-		void Cleanup();
-		void SetDifficulty(unsigned short int d);
-		void SaveHighscore(unsigned int s);
-		void ReadHighscore();
-		int Draw(Uint32 elapsedTime, unsigned short int gameState);
-
-		void Rotate(Uint32 elapsedTime, int dir);
-
-		double GetRotation();
+		void SetHighscoreDepth(unsigned int entries);
+		void SubmitScore(unsigned short int difficulty, unsigned int score);
+		void SaveHighscores();
+		void Draw(Uint32 elapsedTime, unsigned short int gameState, const Simulation &simulation);
+		void DrawOverlay();
 };
 
 #endif
@@ -0,0 +1,88 @@
+#ifndef _HIGHSCORESTORE_H_
+#define _HIGHSCORESTORE_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+
+///
+/// Highscore file: a header followed by one table per difficulty,
+/// 'depth' native endian uint32 scores each, best first. The checksum
+/// is FNV-1a over the tables.
+///
+#define HIGHSCORE_MAGIC 0x53485349 // "ISHS"
+#define HIGHSCORE_VERSION 1
+#define HIGHSCORE_DIFFICULTIES 3
+#define HIGHSCORE_DEFAULT_DEPTH 5
+
+struct HighscoreFileHeader
+{
+	uint32_t magic;
+	uint16_t version, tables;
+	uint32_t depth, checksum;
+};
+
+///
+/// Highscore tables kept in memory, one per difficulty (1 to
+/// HIGHSCORE_DIFFICULTIES). Submit() only touches memory, the file is
+/// rewritten on a background thread, to a temporary file that is then
+/// renamed over the old one, so a crash mid-write keeps the previous
+/// tables.
+///
+class HighscoreStore
+{
+	private:
+		std::string path;
+		unsigned int depth;
+
+		// Every table back to back, 'depth' entries each
+		std::vector<uint32_t> scores;
+
+		// Latest copy waiting to be written, guarded by 'mutex'.
+		// Sized once, so Submit() never allocates.
+		std::vector<uint32_t> pending;
+		bool dirty, stopping;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::thread writer;
+
+		bool Read(const char* file);
+		void ImportText(const char* file);
+		void WriterLoop();
+
+		HighscoreStore(const HighscoreStore&);
+		HighscoreStore& operator=(const HighscoreStore&);
+
+	public:
+		HighscoreStore();
+
+		// Calls Stop()
+		~HighscoreStore();
+
+		// Entries kept per difficulty. Before Load().
+		void SetDepth(unsigned int entries);
+
+		// Reads the tables with one read and starts the writer. A
+		// missing, damaged or foreign file reads as empty tables, a
+		// file of another depth is cut or padded. Without one, the
+		// old highscores.txt list (if any) seeds every table.
+		void Load(const char* path, const char* legacyPath = nullptr);
+
+		// Inserts the score if it makes the difficulty's table, and
+		// queues a save. Returns its rank (0 is best), -1 otherwise.
+		int Submit(unsigned short int difficulty, unsigned int score);
+
+		// Writes what is still pending and joins the writer. Scores
+		// submitted afterwards stay in memory.
+		void Stop();
+
+		// Sorted best first, Depth() entries
+		const uint32_t* Scores(unsigned short int difficulty) const;
+		unsigned int Depth() const { return depth; }
+};
+
+#endif // _HIGHSCORESTORE_H_
@@ -0,0 +1,39 @@
+#ifndef _LEVELANALYZER_H_
+#define _LEVELANALYZER_H_
+
+#include <stdint.h>
+
+struct LevelAnalysisOptions
+{
+	uint64_t sequences;
+
+	// Obstacles per sequence
+	unsigned int length;
+
+	// 0 uses every hardware thread
+	unsigned int threads;
+
+	// 1 to 3, or 0 for all of them
+	unsigned short int difficulty;
+
+	// Tunnel mode, 4, 6 or 8
+	unsigned short int sides;
+
+	// Sequence i is generated from a seed derived from this and i
+	uint32_t seed;
+
+	LevelAnalysisOptions();
+};
+
+///
+/// Generates obstacle sequences the way Simulation does, without the
+/// generator's own check, and counts how many of them can't be
+/// survived according to the Solvability tables
+///
+class LevelAnalyzer
+{
+	public:
+		static bool Run(const LevelAnalysisOptions &options);
+};
+
+#endif // _LEVELANALYZER_H_
@@ -0,0 +1,73 @@
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+#include <stddef.h>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+
+// Messages below this level are compiled out entirely
+#ifndef LOG_MIN_LEVEL
+#ifdef DEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+// Queue slots, must be a power of two. When the queue is full
+// new messages are dropped (and counted) instead of waiting.
+#define LOG_QUEUE_SIZE 1024
+
+// Longer messages are truncated
+#define LOG_MESSAGE_SIZE 256
+
+///
+/// Asynchronous logger. Callers format into a queue slot and return;
+/// a background thread writes to the log file and stdout.
+///
+class Logger
+{
+	public:
+		// Opens (appends to) the log file and starts the writer thread.
+		// Once the file grows past maxBytes it is renamed to
+		// path.1 (path.2 and so on for older ones, up to maxFiles).
+		static bool Start(const char* path, size_t maxBytes = 1 << 20, unsigned int maxFiles = 3);
+
+		// Writes out everything queued and stops the writer thread
+		static void Stop();
+
+		// printf-style, never blocks or allocates
+		static void Write(int level, const char* format, ...)
+#ifdef __GNUC__
+			__attribute__((format(printf, 2, 3)))
+#endif
+			;
+
+		// Messages lost to a full queue
+		static unsigned long Dropped();
+};
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Logger::Write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Logger::Write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) Logger::Write(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) Logger::Write(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif // _LOGGER_H_
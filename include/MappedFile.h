@@ -0,0 +1,30 @@
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <stddef.h>
+
+///
+/// Read-only memory mapping of a whole file
+///
+class MappedFile
+{
+	private:
+		const unsigned char *data;
+		size_t size;
+
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool Open(const char *path);
+		void Close();
+
+		bool IsOpen() const { return data != nullptr; }
+		const unsigned char* Data() const { return data; }
+		size_t Size() const { return size; }
+};
+
+#endif // _MAPPEDFILE_H_
@@ -1,20 +1,21 @@
 #ifndef _OBSTACLE_H_
 #define _OBSTACLE_H_
 
+#include <FixedPoint.h>
+#include <Tunnel.h>
+
 class Obstacle
 {
 	public:
 		// Constructor
-		Obstacle(bool side[6], unsigned int distance);
-
-		// Move
-		void Update(double speed);
+		Obstacle(LaneMask blocked, Fixed position);
 
-		// Which sides of the hexagon the obstacle occupies
-		bool side[6];
+		// Which sides of the tunnel the obstacle occupies
+		LaneMask blocked;
 
-		// How far away from the player it is
-		double distance;
+		// Where along the track it is. Obstacles never move, the
+		// track does: ObstacleTrack::Distance() is how far away it is.
+		Fixed position;
 };
 
 #endif
@@ -0,0 +1,88 @@
+#ifndef _OBSTACLETRACK_H_
+#define _OBSTACLETRACK_H_
+
+#include <vector>
+
+#include <stddef.h>
+
+#include <FixedPoint.h>
+#include <Obstacle.h>
+
+// Obstacles hit the ship while their distance is in [SIM_PASSED,
+// SIM_COLLIDES), and are gone once below SIM_PASSED
+#define SIM_COLLIDES (-45 * FIXED_ONE / 10)
+#define SIM_PASSED (-55 * FIXED_ONE / 10)
+
+// Positions are rebased before the distance travelled gets this big,
+// which leaves room for obstacles about a million units ahead
+#define TRACK_REBASE (1 << 30)
+
+///
+/// Obstacles, nearest first, as a slice of an ObstacleTrack
+///
+class ObstacleRange
+{
+	private:
+		const Obstacle *first, *last;
+
+	public:
+		ObstacleRange(const Obstacle *first, const Obstacle *last) : first(first), last(last) {}
+
+		const Obstacle* begin() const { return first; }
+		const Obstacle* end() const { return last; }
+		size_t size() const { return last - first; }
+		bool empty() const { return first == last; }
+		const Obstacle& operator[](size_t i) const { return first[i]; }
+};
+
+///
+/// Obstacles sorted by where they are along the track. Moving them all
+/// is one addition to the distance travelled, and cursors that only
+/// ever move forward mark the passed ones and the ones close enough
+/// to hit. A tick costs the obstacles it passes, not the ones ahead.
+///
+class ObstacleTrack
+{
+	private:
+		std::vector<Obstacle> obstacles;
+
+		// First one not passed yet, and first one too far to hit
+		size_t head, colliding;
+
+		Fixed travelled;
+
+		void Compact();
+
+	public:
+		ObstacleTrack();
+
+		void Clear();
+
+		// Room for this many live obstacles. Add() reuses the slots of
+		// passed ones before it grows.
+		void Reserve(size_t count);
+
+		// At 'distance' from the ship, no nearer than the last one
+		void Add(LaneMask blocked, Fixed distance);
+
+		// Moves the ship forward. Returns how many obstacles it passed.
+		unsigned int Advance(Fixed amount);
+
+		Fixed Distance(const Obstacle &o) const { return o.position - travelled; }
+
+		// Everything not passed yet
+		ObstacleRange All() const;
+
+		// Ones at [SIM_PASSED, SIM_COLLIDES), that can hit the ship now
+		ObstacleRange Colliding() const;
+
+		// Ones too far to hit yet
+		ObstacleRange Ahead() const;
+
+		// Ones at a distance in [near, far), by binary search
+		ObstacleRange Within(Fixed near, Fixed far) const;
+
+		size_t Size() const { return obstacles.size() - head; }
+};
+
+#endif // _OBSTACLETRACK_H_
@@ -0,0 +1,71 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <stdint.h>
+
+// Zones kept per thread; oldest ones are overwritten
+// once the ring wraps around. Must be a power of two.
+#define PROFILER_RING_SIZE 16384
+
+struct ProfilerZone
+{
+	// Must point to a string literal (or other static storage)
+	const char* name;
+
+	// Nanoseconds since the profiler epoch
+	uint64_t start, end;
+};
+
+class Profiler
+{
+	public:
+		// Innermost zone open on this thread, or nullptr
+		static thread_local const char* currentZone;
+
+		// Monotonic timestamp in nanoseconds
+		static uint64_t Now();
+
+		// Appends a zone to the calling thread's ring buffer.
+		// Never blocks, except for the first call on each thread.
+		static void Record(const char* name, uint64_t start, uint64_t end);
+
+		// Copies the calling thread's zones that started at or after
+		// 'since', most recent first. Returns how many were copied.
+		static unsigned int RecentZones(uint64_t since, ProfilerZone* out, unsigned int max);
+
+		// Name shown for the calling thread in the trace viewer
+		static void SetThreadName(const char* name);
+
+		// Writes every recorded zone as Chrome trace JSON
+		// (chrome://tracing or https://ui.perfetto.dev)
+		static bool Dump(const char* path);
+};
+
+///
+/// Records the lifetime of the enclosing scope as a zone
+///
+class ProfileScope
+{
+	private:
+		const char* name;
+		const char* parent;
+		uint64_t start;
+
+	public:
+		explicit ProfileScope(const char* n) : name(n), parent(Profiler::currentZone), start(Profiler::Now())
+		{
+			Profiler::currentZone = n;
+		}
+
+		~ProfileScope()
+		{
+			Profiler::Record(name, start, Profiler::Now());
+			Profiler::currentZone = parent;
+		}
+};
+
+#define _PROFILE_CONCAT2(a, b) a##b
+#define _PROFILE_CONCAT(a, b) _PROFILE_CONCAT2(a, b)
+#define PROFILE_ZONE(name) ProfileScope _PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+#endif // _PROFILER_H_
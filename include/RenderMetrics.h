@@ -0,0 +1,45 @@
+#ifndef _RENDERMETRICS_H_
+#define _RENDERMETRICS_H_
+
+// Frames kept for the CSV dump. Must be a power of two.
+#define METRICS_HISTORY_SIZE 4096
+
+enum RenderCounter
+{
+	RENDER_DRAW_CALLS,
+	RENDER_PROGRAM_BINDS,
+	RENDER_VAO_BINDS,
+	RENDER_TEXTURE_BINDS,
+	RENDER_UNIFORM_UPLOADS,
+	RENDER_BUFFER_BYTES,
+	RENDER_TEXT_OBJECTS,
+	RENDER_COUNTER_COUNT
+};
+
+///
+/// Per-frame counters for the rendering paths.
+/// Only meant to be touched from the GL thread.
+///
+class RenderMetrics
+{
+	private:
+		static unsigned long current[RENDER_COUNTER_COUNT];
+		static unsigned long history[METRICS_HISTORY_SIZE][RENDER_COUNTER_COUNT];
+		static unsigned long frame;
+
+	public:
+		static void Add(RenderCounter counter, unsigned long n = 1) { current[counter] += n; }
+
+		// Moves the current counters into the history
+		static void EndFrame();
+
+		// Counters of the last completed frame
+		static const unsigned long* LastFrame();
+
+		static const char* Name(RenderCounter counter);
+
+		// Writes one line per frame still in the history
+		static bool DumpCSV(const char* path);
+};
+
+#endif // _RENDERMETRICS_H_
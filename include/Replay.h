@@ -0,0 +1,109 @@
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <WorkQueue.h>
+
+///
+/// Replay file: a header, then one entry per change of the input
+/// state, as a varint of (ticks since the previous change << 2 | new
+/// input bits). The first entry counts from tick 0, where the input
+/// is 0.
+///
+#define REPLAY_MAGIC 0x50525349 // "ISRP"
+#define REPLAY_VERSION 4
+#define REPLAY_EXTENSION ".isr"
+
+// Stream bytes reserved per game. Ten key changes a second, a byte
+// each, fill it in about two hours of play.
+#define REPLAY_RESERVE 65536
+
+// Larger input streams are taken for damaged files rather than read.
+// A change per tick for a whole day of play still fits.
+#define REPLAY_MAX_STREAM (64 * 1024 * 1024)
+
+struct ReplayHeader
+{
+	uint32_t magic;
+	uint16_t version, tickMs;
+	uint32_t seed;
+	uint16_t difficulty, sides;
+
+	// How the game ended, to verify playback against
+	uint32_t ticks, score;
+
+	uint32_t streamSize;
+};
+
+///
+/// Records the input of one game. Record() is called every tick and
+/// only stores changes.
+///
+class InputRecorder
+{
+	private:
+		ReplayHeader header;
+		std::vector<unsigned char> stream;
+		uint32_t lastTick;
+		int lastInput;
+		bool recording;
+
+		// Writes saves in order, one at a time
+		WorkQueue writer;
+
+		// Latest save, still being written
+		std::future<bool> saving;
+
+	public:
+		InputRecorder();
+
+		// Waits for the saves still queued
+		~InputRecorder();
+
+		void Begin(uint32_t seed, unsigned short int difficulty, unsigned short int sides);
+		void Record(uint32_t tick, int input);
+
+		// Ends the game and queues it for the writer thread, which
+		// goes through a temporary file and a rename. Returns without
+		// waiting.
+		void Save(const char* path, uint32_t ticks, unsigned int score);
+		void Wait();
+
+		bool Recording() const { return recording; }
+};
+
+///
+/// Plays a recording back, one tick at a time
+///
+class InputPlayback
+{
+	private:
+		ReplayHeader header;
+
+		// Decoded changes, in tick order
+		std::vector<uint32_t> changeTicks;
+		std::vector<unsigned char> changeInputs;
+		size_t next;
+		int input;
+
+	public:
+		InputPlayback();
+
+		bool Load(const char* path, std::string &error);
+
+		// Input held during 'tick'. Ticks must be asked for in order.
+		int Input(uint32_t tick);
+
+		uint32_t Seed() const { return header.seed; }
+		unsigned short int Difficulty() const { return header.difficulty; }
+		unsigned short int Sides() const { return header.sides; }
+		uint32_t Ticks() const { return header.ticks; }
+		unsigned int Score() const { return header.score; }
+};
+
+#endif // _REPLAY_H_
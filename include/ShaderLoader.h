@@ -1,6 +1,35 @@
 #ifndef _SHADERLOADER_H_
 #define _SHADERLOADER_H_
 
+#include <stdint.h>
+#include <string>
+
+#include <GL/gl.h>
+
+// A program whose compile and link were submitted but not waited on
+struct ShaderProgramBuild
+{
+	GLuint program, vertexShader, fragmentShader;
+	std::string vertexPath, fragmentPath;
+
+	// Program binary cache entry, see ShaderLoader.cpp
+	std::string cachePath;
+	uint64_t cacheKey;
+	bool useCache, cached;
+};
+
+// Submits compile and link without querying any status
+bool BeginLoadShaders(const char * vertex_file_path, const char * fragment_file_path, ShaderProgramBuild &build);
+
+// Never blocks with KHR_parallel_shader_compile, always true without it
+bool IsShaderProgramReady(const ShaderProgramBuild &build);
+
+// Waits for the driver if needed, logs errors and stores the binary
+GLuint FinishLoadShaders(ShaderProgramBuild &build);
+
 GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
 
-#endif
\ No newline at end of file
+// Synchronous, from in-memory sources. Meant for tiny built-in programs.
+GLuint LoadShaderSource(const char * vertex_source, const char * fragment_source);
+
+#endif
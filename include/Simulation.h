@@ -0,0 +1,139 @@
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include <vector>
+
+#include <stdint.h>
+
+#include <FixedPoint.h>
+#include <Obstacle.h>
+#include <ObstacleTrack.h>
+#include <Tunnel.h>
+
+// Length of one simulation step. Frames run as many steps as
+// their elapsed time covers, so play does not depend on frame rate.
+// 5 ms keeps both speeds below whole fixed point units.
+#define SIM_TICK_MS 5
+
+// Obstacles are generated this many at a time, once the level no
+// longer reaches past the lookahead distance
+#define SIM_CHUNK 8
+
+// Default lookahead: the far plane of the camera
+#define SIM_LOOKAHEAD (100 * FIXED_ONE)
+
+// Input bits, one per key held during a tick
+#define SIM_INPUT_LEFT 1
+#define SIM_INPUT_RIGHT 2
+
+///
+/// Gameplay state and rules, without any rendering: the tunnel's
+/// rotation, obstacles, collisions and score. All of it is integer
+/// or fixed-point, so given the same seed, difficulty and inputs per
+/// tick, it plays out bit for bit the same on any build or machine.
+///
+/// The tunnel has 4, 6 or 8 sides. Per tick work is compiled once per
+/// mode, with the lane math of Tunnel<Sides>, and picked by a switch.
+///
+class Simulation
+{
+	private:
+		ObstacleTrack track;
+		uint32_t random;
+
+		unsigned short int difficulty;
+		unsigned short int sides;
+
+		// Multiplier of the rotation speed and score
+		Fixed movementSpeed;
+
+		// In degrees, [0, 360)
+		Fixed tunnelRotation;
+
+		unsigned int score;
+		uint32_t tick;
+		unsigned int passed;
+
+		// Lanes the player can be in when the newest obstacle
+		// reaches them
+		LaneMask reachableLanes;
+
+		// Type of the newest obstacle, and where the next one goes.
+		// It moves along with the obstacles.
+		int lastType;
+		Fixed nextDistance;
+
+		Fixed lookahead;
+
+		void GenerateAhead();
+
+		template <int Sides>
+		void GenerateChunk();
+
+		template <int Sides>
+		bool Collides(int lane) const;
+
+	public:
+		Simulation();
+
+		// Starts a game
+		void Reset(unsigned short int difficulty, uint32_t seed, unsigned short int sides = TUNNEL_DEFAULT_SIDES);
+
+		// Advances one tick. Returns 1 when the ship hit an obstacle.
+		bool Step(int input);
+
+		// How far ahead the level must be generated, from the next
+		// Reset() on. Only changes when obstacles are made, not which.
+		void SetLookahead(Fixed distance);
+
+		// Obstacles up to a chunk past the lookahead
+		const ObstacleTrack& Track() const { return track; }
+		Fixed Rotation() const { return tunnelRotation; }
+		unsigned short int Difficulty() const { return difficulty; }
+		unsigned short int Sides() const { return sides; }
+		unsigned int Score() const { return score; }
+		uint32_t Tick() const { return tick; }
+
+		// Obstacles passed since Reset(), for effects
+		unsigned int Passed() const { return passed; }
+
+		// Rules per difficulty: rotation and obstacle movement per
+		// tick, distance between obstacles and to the first one
+		static Fixed MovementSpeed(unsigned short int difficulty);
+		static Fixed RotationSpeed(unsigned short int difficulty);
+		static Fixed ObstacleSpeed(unsigned short int difficulty);
+		static Fixed ObstacleSpacing(unsigned short int difficulty);
+		static Fixed FirstObstacle(unsigned short int difficulty);
+
+		// Obstacle type for a random number, given the one before it
+		// (-1 for none) and the number of types
+		static int ChooseType(uint32_t random, int lastType, int types);
+
+		// The generator's random numbers, for everything that has to
+		// reproduce or mimic its levels
+		static uint32_t NextRandom(uint32_t &state);
+		static uint32_t MixSeed(uint32_t base, uint64_t index);
+};
+
+// xorshift32, the same sequence on every platform. Advances 'state'
+// and returns it.
+inline uint32_t Simulation::NextRandom(uint32_t &state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// splitmix32 step, so neighbouring games or sequences get unrelated
+// seeds. Never 0, which xorshift32 would stay at.
+inline uint32_t Simulation::MixSeed(uint32_t base, uint64_t index)
+{
+	uint32_t z = base + (uint32_t)index * 0x9e3779b9u;
+	z = (z ^ (z >> 16)) * 0x85ebca6bu;
+	z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+	z ^= z >> 16;
+	return z ? z : 1;
+}
+
+#endif // _SIMULATION_H_
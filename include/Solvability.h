@@ -0,0 +1,52 @@
+#ifndef _SOLVABILITY_H_
+#define _SOLVABILITY_H_
+
+#include <stdint.h>
+
+#include <Tunnel.h>
+
+///
+/// Which lanes the player can get to between two obstacles, worked
+/// out once per difficulty from the rotation speed, obstacle speed and
+/// spacing, down to the tick.
+///
+/// It's optimistic: it lets the player leave a lane from any angle in
+/// it and arrive at any angle in the next. A sequence it rejects can't
+/// be survived, one it accepts may still need very precise play.
+///
+template <int Sides>
+class Solvability
+{
+	private:
+		// [difficulty - 1]
+		LaneMask start[3];
+		LaneMask expand[3][1 << Sides];
+		uint32_t moveTicks[3];
+		uint32_t laneTicks[3][Sides][Sides];
+
+		Solvability();
+		void Build(unsigned short int difficulty);
+
+	public:
+		// Built on first use, safe to call from any thread
+		static const Solvability& Tables();
+
+		// Lanes the player can be in when the first obstacle arrives
+		LaneMask Start(unsigned short int difficulty) const { return start[difficulty - 1]; }
+
+		// Lanes reachable for the next obstacle from the given ones
+		LaneMask Expand(unsigned short int difficulty, LaneMask lanes) const { return expand[difficulty - 1][lanes]; }
+
+		// Lanes the player can be in at an obstacle leaving 'open'
+		// free, coming from 'lanes' at the one before. 0 if none.
+		LaneMask Next(unsigned short int difficulty, LaneMask lanes, LaneMask open) const { return expand[difficulty - 1][lanes] & open; }
+
+		// Ticks between the last one an obstacle can hit and the
+		// first the next one can, at the worst phase
+		uint32_t MoveTicks(unsigned short int difficulty) const { return moveTicks[difficulty - 1]; }
+
+		// Fewest ticks from anywhere in one lane to anywhere in another
+		uint32_t LaneTicks(unsigned short int difficulty, int from, int to) const { return laneTicks[difficulty - 1][from][to]; }
+};
+
+#endif // _SOLVABILITY_H_
@@ -0,0 +1,72 @@
+#ifndef _STARTUPPROFILE_H_
+#define _STARTUPPROFILE_H_
+
+#include <stdint.h>
+
+#include <Profiler.h>
+
+// Phases kept until the first frame of the game proper
+#define STARTUP_MAX_PHASES 32
+
+struct StartupPhase
+{
+	// Must point to a string literal (or other static storage)
+	const char* name;
+
+	// Nanoseconds since the profiler epoch, close to process start
+	uint64_t start, end;
+};
+
+///
+/// Durations of the startup phases, and when the first frames were
+/// presented. Stops recording once the first frame that is not the
+/// loading screen was presented, so phases that run again later
+/// (e.g. ReadHighscore) only count once. Main thread only.
+///
+class StartupProfile
+{
+	private:
+		static StartupPhase phases[STARTUP_MAX_PHASES];
+		static unsigned int count;
+		static uint64_t firstFrame, firstScreenFrame;
+
+	public:
+		static void Record(const char* name, uint64_t start, uint64_t end);
+
+		// Call after each swap. 'loading' is set while only the
+		// loading screen could be drawn.
+		static void FramePresented(bool loading);
+
+		// Whether the first frame of the game proper was presented
+		static bool Complete();
+
+		// Logs every phase
+		static void Report();
+
+		// Appends "label,phase,start_ms,duration_ms" lines, including
+		// first_frame and first_screen_frame measured from 0
+		static bool AppendCSV(const char* path, const char* label);
+};
+
+///
+/// A profiler zone that is also recorded as a startup phase
+///
+class StartupScope
+{
+	private:
+		ProfileScope zone;
+		const char* name;
+		uint64_t start;
+
+	public:
+		explicit StartupScope(const char* n) : zone(n), name(n), start(Profiler::Now()) {}
+
+		~StartupScope()
+		{
+			StartupProfile::Record(name, start, Profiler::Now());
+		}
+};
+
+#define STARTUP_PHASE(name) StartupScope _PROFILE_CONCAT(startupScope, __LINE__)(name)
+
+#endif // _STARTUPPROFILE_H_
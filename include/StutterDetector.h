@@ -0,0 +1,86 @@
+#ifndef _STUTTERDETECTOR_H_
+#define _STUTTERDETECTOR_H_
+
+#include <stdint.h>
+
+#include <Profiler.h>
+
+// Frame times the median is taken over
+#define STUTTER_HISTORY 240
+
+// Frames needed before anything is flagged
+#define STUTTER_WARMUP 30
+
+// Zones inspected per frame
+#define STUTTER_MAX_FRAME_ZONES 256
+
+// Distinct zone names whose typical duration is tracked
+#define STUTTER_MAX_ZONE_NAMES 64
+
+// Spikes kept for the spike log
+#define STUTTER_MAX_SPIKES 256
+
+// What the game was doing when a spike happened
+struct SpikeContext
+{
+	unsigned short int gameState;
+	unsigned int obstacles;
+	unsigned long allocs;
+};
+
+struct SpikeRecord
+{
+	unsigned long frame;
+	double frameMs, medianMs;
+
+	// Innermost zone that ran the most over its typical duration
+	const char* zone;
+	double zoneMs, zoneExcessMs;
+
+	SpikeContext context;
+};
+
+///
+/// Flags frames slower than a multiple of the median frame time
+/// and blames the profiler zone responsible for the overrun
+///
+class StutterDetector
+{
+	private:
+		double budget;
+
+		uint64_t history[STUTTER_HISTORY];
+		unsigned int historyCount;
+		unsigned long frame;
+
+		// Exponential moving average of each zone's duration
+		const char* zoneNames[STUTTER_MAX_ZONE_NAMES];
+		double zoneTypical[STUTTER_MAX_ZONE_NAMES];
+
+		ProfilerZone frameZones[STUTTER_MAX_FRAME_ZONES];
+
+		SpikeRecord spikes[STUTTER_MAX_SPIKES];
+		unsigned long spikeCount;
+
+		double* Typical(const char* name);
+		uint64_t Median();
+		const ProfilerZone* Blame(unsigned int zoneCount, double* excess);
+
+	public:
+		StutterDetector();
+
+		// A frame is a spike when it takes longer than
+		// medianMultiplier times the median frame time
+		void SetBudget(double medianMultiplier);
+
+		// Call on the main thread, after the frame's zones closed.
+		// Returns true if the frame was flagged.
+		bool EndFrame(uint64_t frameStart, uint64_t frameEnd, const SpikeContext& context);
+
+		unsigned long Spikes();
+
+		// Appends one line per recorded spike
+		bool DumpLog(const char* path);
+};
+
+#endif // _STUTTERDETECTOR_H_
@@ -1,3 +1,57 @@
+#ifndef _TEXTURELOADER_H_
+#define _TEXTURELOADER_H_
+
 #include <GL/gl.h>
 
-GLuint LoadTexture(const char * bitmap_file);
+class TextureStreamer;
+struct StreamRequest;
+
+// CPU side pixels, as returned by stb_image
+struct DecodedImage
+{
+    unsigned char *pixels;
+    int width, height, channels;
+};
+
+// Per-texture sampling. Defaults to trilinear filtering over a
+// generated mip chain, without anisotropy.
+struct TextureSampler
+{
+    GLenum minFilter, magFilter;
+    GLenum wrapS, wrapT;
+    bool mipmaps;
+
+    // Clamped to what the driver supports, ignored without the extension
+    float anisotropy;
+
+    TextureSampler();
+};
+
+// Safe to call from any thread
+DecodedImage DecodeTexture(const char * bitmap_file);
+
+// Any thread. Checks that same-sized images can be packed into one
+// RGBA8 GL_TEXTURE_2D_ARRAY, layer i from bitmap_files[i], and lists
+// every level of every layer in 'request'. Layers with an up to date
+// baked file use it, the others must be decoded in 'images' (which the
+// request takes over or frees). Mip levels a layer has no baked file
+// for are built per layer on the CPU, baked chains are never
+// regenerated. Returns 0 and leaves 'request' empty when a layer is
+// missing or the sizes differ.
+bool PrepareTextureArray(const char * const * bitmap_files, DecodedImage *images, unsigned int layers, const TextureSampler &sampler,
+    StreamRequest &request);
+
+// GL thread only. Uploads a prepared request right away and frees its
+// decoded images. Returns -1 for an empty request.
+GLuint UploadTextureArray(StreamRequest &request, const TextureSampler &sampler = TextureSampler());
+
+// GL thread only. Same as UploadTextureArray, but only allocates the
+// texture and hands the request to 'streamer', which fills it over the
+// next frames. Sample it once streamer.Done(ticket). Allocates no
+// memory unless many requests stream at once.
+GLuint StreamTextureArray(StreamRequest &request, const TextureSampler &sampler, TextureStreamer &streamer, unsigned int &ticket);
+
+// Whether a valid, up to date baked file exists
+bool HasBakedTexture(const char * bitmap_file);
+
+#endif // _TEXTURELOADER_H_
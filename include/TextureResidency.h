@@ -0,0 +1,83 @@
+#ifndef _TEXTURERESIDENCY_H_
+#define _TEXTURERESIDENCY_H_
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <GL/gl.h>
+
+#include <TextureLoader.h>
+#include <TextureStreamer.h>
+#include <WorkQueue.h>
+
+///
+/// Keeps groups of textures (each uploaded as one 2D array) on the
+/// GPU only while they are needed. Sets are uploaded on first use,
+/// can be decoded ahead of time on a worker thread and then streamed
+/// in over a few frames, and the least recently used ones are evicted
+/// when resident bytes exceed the budget. GL calls only happen in
+/// Update(), Acquire() and Evict().
+///
+class TextureResidency
+{
+	private:
+		struct TextureSet
+		{
+			std::vector<const char*> paths;
+			TextureSampler sampler;
+
+			GLuint texture;
+			size_t bytes;
+			uint64_t lastUsed, lastUsedFrame;
+
+			// Decoded and prepared on the worker, from Prefetch()
+			std::future<StreamRequest> pending;
+
+			// Prefetched and not acquired since, and still filling up
+			bool prefetched, streaming;
+			unsigned int ticket;
+		};
+
+		std::vector<TextureSet> sets;
+		size_t budget, residentBytes;
+		uint64_t useClock, frame;
+		TextureStreamer streamer;
+
+		// Prefetch() decodes here, one set after another
+		WorkQueue decoder;
+
+		void Load(unsigned int set);
+		void StartStreaming(unsigned int set);
+		void EnforceBudget();
+
+	public:
+		TextureResidency();
+		~TextureResidency();
+
+		// Images of one set must share a size. Returns the set's id.
+		unsigned int Register(const char * const *paths, unsigned int count, const TextureSampler &sampler);
+
+		// Starts decoding a set in the background, if not resident.
+		// Update() streams it in once decoded, without allocating.
+		void Prefetch(unsigned int set);
+
+		// Once per frame, before any Acquire(). Uploads at most
+		// STREAM_SLOT_BYTES of prefetched pixels.
+		void Update();
+
+		// Uploads the set if needed and returns its texture array.
+		// Blocks only when the set was not prefetched far enough ahead.
+		GLuint Acquire(unsigned int set);
+
+		void Evict(unsigned int set);
+
+		void SetBudget(size_t bytes);
+		size_t ResidentBytes() const;
+		bool IsResident(unsigned int set) const;
+};
+
+#endif // _TEXTURERESIDENCY_H_
@@ -0,0 +1,126 @@
+#ifndef _TEXTURESTREAMER_H_
+#define _TEXTURESTREAMER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+
+#include <GL/gl.h>
+
+#include <MappedFile.h>
+#include <TextureLoader.h>
+
+// Pixel unpack buffers in the ring, and how much each holds
+#define STREAM_SLOTS 4
+#define STREAM_SLOT_BYTES (4u << 20)
+
+// Requests in flight that fit without growing the list
+#define STREAM_REQUESTS_RESERVED 8
+
+// One level of one layer of a 2D array, stored as RGBA8. 1 to 3
+// channel sources are expanded while copying.
+struct TextureUpload
+{
+	const unsigned char *pixels;
+	int width, height, channels;
+	GLint level, layer;
+};
+
+// Everything needed to fill one texture
+struct StreamRequest
+{
+	GLuint texture;
+	int width, height;
+	unsigned int layers, levels;
+
+	// Every level of every layer, mipmaps included
+	std::vector<TextureUpload> uploads;
+
+	// What 'uploads' point into, released once all of it was copied:
+	// decoded images, levels built at load time and baked files
+	std::vector<DecodedImage> images;
+	std::vector<std::vector<unsigned char>> generated;
+	std::vector<std::unique_ptr<MappedFile>> mappings;
+
+	StreamRequest();
+};
+
+///
+/// Streams pixels into textures through a ring of pixel unpack
+/// buffers. A worker thread copies rows into mapped buffers, the GL
+/// thread only unmaps them and issues glTexSubImage3D from the
+/// buffer, then fences it before reuse. Textures fill up over a few
+/// frames instead of stalling one, and the GL thread's side of it
+/// does not allocate.
+///
+class TextureStreamer
+{
+	private:
+		enum CopyState { COPY_NONE, COPY_QUEUED, COPY_RUNNING, COPY_DONE };
+
+		struct Slot
+		{
+			GLuint buffer;
+			size_t capacity;
+			unsigned char *mapped;
+			GLsync fence;
+
+			// Rows the copy thread writes into 'mapped', and where
+			// they go. Changes to 'copy' that wake the other thread
+			// are made under 'mutex'.
+			std::atomic<CopyState> copy;
+			unsigned int ticket;
+			TextureUpload upload;
+			int firstRow, rows;
+		};
+
+		struct Active
+		{
+			unsigned int ticket;
+			StreamRequest request;
+			size_t nextUpload;
+			int nextRow;
+			unsigned int copying;
+		};
+
+		Slot slots[STREAM_SLOTS];
+		std::vector<Active> active;
+		unsigned int nextTicket;
+		bool initialized;
+
+		// One thread for the whole session, started with the buffers.
+		// It takes queued slots, so handing it rows needs no memory.
+		std::thread copier;
+		std::mutex mutex;
+		std::condition_variable queued, copied;
+		bool stopping;
+
+		Active* Find(unsigned int ticket);
+		size_t StartCopy(Slot &slot, Active &active);
+		void FinishCopy(Slot &slot);
+		void Release(Active &active);
+		void CopyLoop();
+
+	public:
+		TextureStreamer();
+		~TextureStreamer();
+
+		// Takes over the request. Returns a ticket for Done() and Finish().
+		unsigned int Submit(StreamRequest &request);
+
+		// GL thread, once per frame. Starts at most 'maxBytes' of new
+		// copies. Never blocks unless 'wait' is set.
+		void Pump(size_t maxBytes, bool wait = false);
+
+		bool Done(unsigned int ticket);
+
+		// Blocks until the texture is complete
+		void Finish(unsigned int ticket);
+};
+
+#endif // _TEXTURESTREAMER_H_
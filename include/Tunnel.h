@@ -0,0 +1,172 @@
+#ifndef _TUNNEL_H_
+#define _TUNNEL_H_
+
+#include <stdint.h>
+
+#include <FixedPoint.h>
+
+// Tunnel modes, by number of sides
+#define TUNNEL_DEFAULT_SIDES 6
+#define TUNNEL_MAX_SIDES 8
+
+#define TUNNEL_PI 3.14159265358979323846
+
+// Distance from the tunnel's axis to the middle of a face, and to the
+// middle of an obstacle, whatever the number of sides
+#define TUNNEL_APOTHEM 1.73
+#define OBSTACLE_APOTHEM 1.70
+
+// One bit per lane, 1 << lane
+typedef uint8_t LaneMask;
+
+///
+/// Compile time trig. Taylor series after reducing to [-pi, pi], well
+/// within float precision.
+///
+constexpr double TunnelSin(double x)
+{
+	while (x > TUNNEL_PI)
+		x -= 2 * TUNNEL_PI;
+	while (x < -TUNNEL_PI)
+		x += 2 * TUNNEL_PI;
+
+	double term = x, sum = x;
+	for (int n = 1; n < 12; ++n)
+	{
+		term *= -x * x / ((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double TunnelCos(double x)
+{
+	return TunnelSin(x + TUNNEL_PI / 2);
+}
+
+///
+/// Per lane angles of an unrotated tunnel, lane 0 being right under
+/// the ship. Drawing subtracts the tunnel's rotation from these.
+///
+template <int Sides>
+struct TunnelTables
+{
+	// In degrees
+	float angle[Sides];
+	float cosine[Sides], sine[Sides];
+
+	// Half the width of a face
+	float halfSide;
+
+	constexpr TunnelTables() : angle(), cosine(), sine(), halfSide()
+	{
+		for (int i = 0; i < Sides; ++i)
+		{
+			double degrees = i * 360.0 / Sides - 90;
+			angle[i] = degrees;
+			cosine[i] = TunnelCos(degrees * TUNNEL_PI / 180);
+			sine[i] = TunnelSin(degrees * TUNNEL_PI / 180);
+		}
+
+		halfSide = TUNNEL_APOTHEM * TunnelSin(TUNNEL_PI / Sides) / TunnelCos(TUNNEL_PI / Sides);
+	}
+};
+
+///
+/// Obstacle types for each tunnel mode, as the lanes they block.
+/// Defined in Tunnel.cpp.
+///
+template <int Sides>
+struct TunnelPatterns;
+
+template <>
+struct TunnelPatterns<4>
+{
+	static constexpr int count = 6;
+	static const LaneMask blocked[count];
+};
+
+template <>
+struct TunnelPatterns<6>
+{
+	static constexpr int count = 11;
+	static const LaneMask blocked[count];
+};
+
+template <>
+struct TunnelPatterns<8>
+{
+	static constexpr int count = 14;
+	static const LaneMask blocked[count];
+};
+
+///
+/// Everything that depends on the number of sides: lane math, masks
+/// and the tables above. Lanes are numbered the way the tunnel turns.
+///
+template <int Sides>
+struct Tunnel
+{
+	static_assert(Sides >= 3 && Sides <= TUNNEL_MAX_SIDES, "lanes must fit a LaneMask");
+	static_assert(360 * FIXED_ONE % Sides == 0, "lanes must be a whole number of thousandths wide");
+
+	static constexpr int sides = Sides;
+	static constexpr Fixed laneWidth = 360 * FIXED_ONE / Sides;
+	static constexpr LaneMask allLanes = (1 << Sides) - 1;
+
+	static constexpr TunnelTables<Sides> tables = TunnelTables<Sides>();
+
+	// Lane the ship is in at a rotation in [0, 360)
+	static constexpr int Lane(Fixed rotation)
+	{
+		return (rotation + laneWidth / 2) / laneWidth % Sides;
+	}
+
+	static constexpr bool Blocks(LaneMask blocked, int lane)
+	{
+		return (blocked >> lane) & 1;
+	}
+
+	static constexpr int Types()
+	{
+		return TunnelPatterns<Sides>::count;
+	}
+
+	static LaneMask Blocked(int type)
+	{
+		return TunnelPatterns<Sides>::blocked[type];
+	}
+
+	static LaneMask Open(int type)
+	{
+		return allLanes & ~TunnelPatterns<Sides>::blocked[type];
+	}
+};
+
+template <int Sides>
+constexpr TunnelTables<Sides> Tunnel<Sides>::tables;
+
+///
+/// Lane directions of a tunnel turned by some angle, from the tables
+/// above and that angle's cosine and sine by angle addition, so a
+/// frame needs no trig per lane. One flat loop over arrays with a
+/// fixed count, which the compiler vectorizes.
+///
+template <int Sides>
+struct TunnelLanes
+{
+	float cosine[Sides], sine[Sides];
+
+	// Lanes turn the opposite way to the tunnel's rotation
+	void Rotate(float cosRotation, float sinRotation)
+	{
+		const TunnelTables<Sides> &t = Tunnel<Sides>::tables;
+		for (int i = 0; i < Sides; ++i)
+		{
+			cosine[i] = t.cosine[i] * cosRotation + t.sine[i] * sinRotation;
+			sine[i] = t.sine[i] * cosRotation - t.cosine[i] * sinRotation;
+		}
+	}
+};
+
+#endif // _TUNNEL_H_
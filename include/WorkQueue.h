@@ -0,0 +1,58 @@
+#ifndef _WORKQUEUE_H_
+#define _WORKQUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+///
+/// Long-lived worker threads fed by a queue. Threads start on the
+/// first Push() and live until the queue is destroyed, so work that
+/// comes and goes mid-session never pays for a new thread (nor for
+/// another profiler ring).
+///
+class WorkQueue
+{
+	private:
+		const char* name;
+		unsigned int threadCount;
+
+		std::deque<std::function<void()>> jobs;
+		bool stopping;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::vector<std::thread> threads;
+
+		void Enqueue(std::function<void()> job);
+		void WorkerLoop();
+
+		WorkQueue(const WorkQueue&);
+		WorkQueue& operator=(const WorkQueue&);
+
+	public:
+		// 'name' shows up in traces and must be a string literal
+		explicit WorkQueue(const char* name, unsigned int threads = 1);
+
+		// Runs whatever is still queued, then joins
+		~WorkQueue();
+
+		// Jobs run in the order pushed, one at a time per thread
+		template <typename Job>
+		std::future<typename std::result_of<Job()>::type> Push(Job job)
+		{
+			typedef typename std::result_of<Job()>::type Result;
+
+			std::shared_ptr<std::packaged_task<Result()>> task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+			std::future<Result> result = task->get_future();
+			Enqueue([task]() { (*task)(); });
+			return result;
+		}
+};
+
+#endif // _WORKQUEUE_H_
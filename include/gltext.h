@@ -235,6 +235,11 @@ struct GLTtext {
 	GLsizei vertexCount;
 	GLfloat *_vertices;
 
+	// Allocated sizes, kept so a changing string that still fits
+	// (a score counting up) does not allocate
+	GLsizei _textCapacity;
+	GLsizei _verticesCapacity;
+
 	GLuint _vao;
 	GLuint _vbo;
 };
@@ -334,8 +339,19 @@ GLT_API GLboolean gltSetText(GLTtext *text, const char *string)
 			if (strcmp(string, text->_text) == 0)
 				return GL_TRUE;
 
+			if (strLength < text->_textCapacity)
+			{
+				memcpy(text->_text, string, (strLength + 1) * sizeof(char));
+
+				text->_textLength = strLength;
+				text->_dirty = GL_TRUE;
+
+				return GL_TRUE;
+			}
+
 			free(text->_text);
 			text->_text = GLT_NULL;
+			text->_textCapacity = 0;
 		}
 
 		text->_text = (char*)malloc((strLength + 1) * sizeof(char));
@@ -344,6 +360,7 @@ GLT_API GLboolean gltSetText(GLTtext *text, const char *string)
 		{
 			memcpy(text->_text, string, (strLength + 1) * sizeof(char));
 
+			text->_textCapacity = strLength + 1;
 			text->_textLength = strLength;
 			text->_dirty = GL_TRUE;
 
@@ -356,6 +373,7 @@ GLT_API GLboolean gltSetText(GLTtext *text, const char *string)
 		{
 			free(text->_text);
 			text->_text = GLT_NULL;
+			text->_textCapacity = 0;
 		}
 		else
 		{
@@ -717,13 +735,7 @@ GLT_API void _gltUpdateBuffers(GLTtext *text)
 		return;
 
 
-	if (text->_vertices)
-	{
-		text->vertexCount = 0;
-
-		free(text->_vertices);
-		text->_vertices = GLT_NULL;
-	}
+	text->vertexCount = 0;
 
 	if (!text->_text || !text->_textLength)
 	{
@@ -744,10 +756,21 @@ GLT_API void _gltUpdateBuffers(GLTtext *text)
 	const GLsizei vertexCount = countDrawable * 2 * 3; // 3 vertices in a triangle, 2 triangles in a quad
 
 	const GLsizei vertexSize = _GLT_TEXT2D_VERTEX_SIZE;
-	GLfloat *vertices = (GLfloat*)malloc(vertexCount * vertexSize * sizeof(GLfloat));
+	GLfloat *vertices = text->_vertices;
 
-	if (!vertices)
-		return;
+	if (vertexCount > text->_verticesCapacity)
+	{
+		if (text->_vertices)
+			free(text->_vertices);
+
+		text->_verticesCapacity = 0;
+		text->_vertices = vertices = (GLfloat*)malloc(vertexCount * vertexSize * sizeof(GLfloat));
+
+		if (!vertices)
+			return;
+
+		text->_verticesCapacity = vertexCount;
+	}
 
 
 	GLsizei vertexElementIndex = 0;
@@ -840,7 +863,6 @@ GLT_API void _gltUpdateBuffers(GLTtext *text)
 
 
 	text->vertexCount = vertexCount;
-	text->_vertices = vertices;
 
 
 	glBindBuffer(GL_ARRAY_BUFFER, text->_vbo);
@@ -1,7 +1,8 @@
 #version 330 core
 
 uniform mat4 model;
-uniform sampler2D tex;
+uniform sampler2DArray tex;
+uniform int layer;
 
 uniform struct Light {
    vec3 position;
@@ -33,7 +34,7 @@ void main()
     //calculate final color of the pixel, based on:
     // 1. The angle of incidence: brightness
     // 2. The color/intensities of the light: light.rgb
-    // 3. The texture and texture coord: texture(tex, fragTexCoord)
-    vec4 surfaceColor = texture(tex, fragTexCoord);
+    // 3. The texture and texture coord: texture(tex, vec3(fragTexCoord, layer))
+    vec4 surfaceColor = texture(tex, vec3(fragTexCoord, layer));
     finalColor = vec4(brightness * light.rgb * surfaceColor.rgb, surfaceColor.a);
 }
@@ -1,25 +1,27 @@
-#version 330 core
-
-// https://www.tomdalling.com/blog/modern-opengl/06-diffuse-point-lighting/
-
-uniform mat4 camera;
-uniform mat4 model;
-
-in vec3 vert;
-in vec2 vertTexCoord;
-in vec3 vertNormal;
-
-out vec3 fragVert;
-out vec2 fragTexCoord;
-out vec3 fragNormal;
-
-void main()
-{
-    // Pass input variables into the shader
-    fragTexCoord = vertTexCoord;
-    fragNormal = vertNormal;
-    fragVert = vert;
-    
-    // Apply all matrix transformations to vert
-    gl_Position = camera * model * vec4(vert, 1);
-}
+#version 330 core
+
+// https://www.tomdalling.com/blog/modern-opengl/06-diffuse-point-lighting/
+
+uniform mat4 camera;
+uniform mat4 model;
+
+// Fixed, so VAOs can be set up while this still compiles
+// (ATTRIB_* in Geometry.h)
+layout(location = 0) in vec3 vert;
+layout(location = 1) in vec2 vertTexCoord;
+layout(location = 2) in vec3 vertNormal;
+
+out vec3 fragVert;
+out vec2 fragTexCoord;
+out vec3 fragNormal;
+
+void main()
+{
+    // Pass input variables into the shader
+    fragTexCoord = vertTexCoord;
+    fragNormal = vertNormal;
+    fragVert = vert;
+    
+    // Apply all matrix transformations to vert
+    gl_Position = camera * model * vec4(vert, 1);
+}
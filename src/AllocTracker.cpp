@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AllocTracker.h>
+#include <Profiler.h>
+
+// Every tracked block is prefixed with its size, padded so
+// the pointer handed out keeps malloc's alignment
+#define ALLOC_HEADER alignof(std::max_align_t)
+
+struct AllocZone
+{
+	std::atomic<const char*> name;
+	std::atomic<unsigned long> allocs, bytes, frameBytes;
+};
+
+struct AllocViolation
+{
+	unsigned long frame, allocs, bytes;
+	const char* zone;
+};
+
+static const char* unzoned = "(no zone)";
+static const char* overflow = "(zone table full)";
+
+// Static storage, zero-initialized before any allocation can happen
+static AllocZone zones[ALLOC_MAX_ZONES];
+static AllocZone overflowZone;
+static std::atomic<unsigned long> totalAllocs, totalBytes;
+static std::atomic<long> liveBytes, peakLiveBytes;
+
+// Frames belong to the thread that ends them: workers decoding, copying
+// or logging in the background count in the totals and zones, not
+// against the frame they happen to overlap
+static thread_local bool frameThread = false;
+static unsigned long frameAllocs = 0, frameBytes = 0;
+static bool expectNoAllocs = false;
+
+// Only touched from EndFrame(), on the main thread
+static unsigned long frame = 0;
+static unsigned long violationCount = 0;
+static AllocViolation violations[ALLOC_MAX_VIOLATIONS];
+
+// Open addressing on the zone name pointer. Names are string
+// literals, so the same zone always maps to the same slot.
+static AllocZone* FindZone(const char* name)
+{
+	if (!name)
+		name = unzoned;
+
+	uintptr_t hash = ((uintptr_t)name >> 3) * 2654435761u;
+	for (unsigned int probe = 0; probe < ALLOC_MAX_ZONES; ++probe)
+	{
+		AllocZone& zone = zones[(hash + probe) % ALLOC_MAX_ZONES];
+		const char* current = zone.name.load(std::memory_order_acquire);
+
+		if (current == name)
+			return &zone;
+
+		if (!current)
+		{
+			const char* expected = nullptr;
+			if (zone.name.compare_exchange_strong(expected, name) || expected == name)
+				return &zone;
+		}
+	}
+
+	overflowZone.name.store(overflow, std::memory_order_relaxed);
+	return &overflowZone;
+}
+
+///
+/// Counting
+///
+bool AllocTracker::Enabled()
+{
+#ifdef TRACK_ALLOCS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void AllocTracker::OnAlloc(size_t size)
+{
+	totalAllocs.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+
+	AllocZone* zone = FindZone(Profiler::currentZone);
+	zone->allocs.fetch_add(1, std::memory_order_relaxed);
+	zone->bytes.fetch_add(size, std::memory_order_relaxed);
+
+	if (frameThread)
+	{
+		++frameAllocs;
+		frameBytes += size;
+		zone->frameBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	long live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	long peak = peakLiveBytes.load(std::memory_order_relaxed);
+	while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		;
+}
+
+void AllocTracker::OnFree(size_t size)
+{
+	liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void AllocTracker::ExpectNoAllocs(bool expect)
+{
+	frameThread = true;
+	expectNoAllocs = expect;
+}
+
+AllocFrameStats AllocTracker::EndFrame()
+{
+	frameThread = true;
+
+	AllocFrameStats stats;
+	stats.allocs = frameAllocs;
+	stats.bytes = frameBytes;
+	frameAllocs = frameBytes = 0;
+	stats.liveBytes = liveBytes.load(std::memory_order_relaxed);
+	stats.topZone = nullptr;
+
+	unsigned long topBytes = 0;
+	for (int i = 0; i < ALLOC_MAX_ZONES; ++i)
+	{
+		unsigned long bytes = zones[i].frameBytes.exchange(0, std::memory_order_relaxed);
+		if (bytes > topBytes)
+		{
+			topBytes = bytes;
+			stats.topZone = zones[i].name.load(std::memory_order_relaxed);
+		}
+	}
+
+	if (expectNoAllocs && stats.allocs)
+	{
+		if (violationCount < ALLOC_MAX_VIOLATIONS)
+		{
+			AllocViolation& v = violations[violationCount];
+			v.frame = frame;
+			v.allocs = stats.allocs;
+			v.bytes = stats.bytes;
+			v.zone = stats.topZone;
+		}
+		++violationCount;
+	}
+
+	++frame;
+	return stats;
+}
+
+unsigned long AllocTracker::Violations()
+{
+	return violationCount;
+}
+
+///
+/// Report
+///
+static bool MoreBytes(const AllocZone* a, const AllocZone* b)
+{
+	return a->bytes.load(std::memory_order_relaxed) > b->bytes.load(std::memory_order_relaxed);
+}
+
+bool AllocTracker::DumpReport(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return 0;
+
+	fprintf(file, "frames: %lu\n", frame);
+	fprintf(file, "allocations: %lu (%lu bytes)\n", totalAllocs.load(), totalBytes.load());
+	fprintf(file, "live bytes: %ld, peak %ld\n", liveBytes.load(), peakLiveBytes.load());
+	fprintf(file, "allocating frames that were expected not to: %lu\n", violationCount);
+
+	std::vector<const AllocZone*> sorted;
+	for (int i = 0; i < ALLOC_MAX_ZONES; ++i)
+		if (zones[i].name.load(std::memory_order_relaxed))
+			sorted.push_back(&zones[i]);
+	if (overflowZone.name.load(std::memory_order_relaxed))
+		sorted.push_back(&overflowZone);
+	std::sort(sorted.begin(), sorted.end(), MoreBytes);
+
+	fputs("\nzone,allocs,bytes\n", file);
+	for (const AllocZone* zone : sorted)
+		fprintf(file, "%s,%lu,%lu\n", zone->name.load(), zone->allocs.load(), zone->bytes.load());
+
+	fputs("\nframe,allocs,bytes,top zone\n", file);
+	for (unsigned long i = 0; i < violationCount && i < ALLOC_MAX_VIOLATIONS; ++i)
+	{
+		fprintf(file, "%lu,%lu,%lu,%s\n", violations[i].frame, violations[i].allocs,
+			violations[i].bytes, violations[i].zone ? violations[i].zone : unzoned);
+	}
+
+	return fclose(file) == 0;
+}
+
+///
+/// Tracked C allocation functions
+///
+void* TrackedMalloc(size_t size)
+{
+	char* block = (char*)malloc(size + ALLOC_HEADER);
+	if (!block)
+		return nullptr;
+
+	*(size_t*)block = size;
+	AllocTracker::OnAlloc(size);
+	return block + ALLOC_HEADER;
+}
+
+void* TrackedCalloc(size_t count, size_t size)
+{
+	void* ptr = TrackedMalloc(count * size);
+	if (ptr)
+		memset(ptr, 0, count * size);
+	return ptr;
+}
+
+void* TrackedRealloc(void* ptr, size_t size)
+{
+	if (!ptr)
+		return TrackedMalloc(size);
+
+	char* block = (char*)ptr - ALLOC_HEADER;
+	size_t oldSize = *(size_t*)block;
+
+	block = (char*)realloc(block, size + ALLOC_HEADER);
+	if (!block)
+		return nullptr;
+
+	*(size_t*)block = size;
+	AllocTracker::OnFree(oldSize);
+	AllocTracker::OnAlloc(size);
+	return block + ALLOC_HEADER;
+}
+
+void TrackedFree(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	char* block = (char*)ptr - ALLOC_HEADER;
+	AllocTracker::OnFree(*(size_t*)block);
+	free(block);
+}
+
+///
+/// Global operator new/delete replacements
+///
+#ifdef TRACK_ALLOCS
+void* operator new(size_t size)
+{
+	void* ptr = TrackedMalloc(size);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedMalloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedMalloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	TrackedFree(ptr);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* ptr, size_t) noexcept
+{
+	TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	TrackedFree(ptr);
+}
+#endif
+#endif // TRACK_ALLOCS
@@ -0,0 +1,160 @@
+#include <string.h>
+
+#include <AssetLoader.h>
+#include <AssetPack.h>
+#include <Profiler.h>
+#include <Logger.h>
+
+enum TaskKind
+{
+	TASK_MUSIC,
+	TASK_CHUNK
+};
+
+// Audio is read straight from the asset pack's mapping when it has
+// the file. Music keeps streaming from it, which outlives the music.
+static Mix_Music* LoadMusic(const char* path)
+{
+	const unsigned char* data;
+	size_t size;
+	if (AssetPack::Find(path, data, size))
+		return Mix_LoadMUS_RW(SDL_RWFromConstMem(data, size), 1);
+
+	return Mix_LoadMUS(path);
+}
+
+static Mix_Chunk* LoadChunk(const char* path)
+{
+	const unsigned char* data;
+	size_t size;
+	if (AssetPack::Find(path, data, size))
+		return Mix_LoadWAV_RW(SDL_RWFromConstMem(data, size), 1);
+
+	return Mix_LoadWAV(path);
+}
+
+AssetLoader::AssetLoader() : workers("AssetLoader", ASSET_LOADER_THREADS)
+{
+	totalWork = 0;
+	totalWaited = 0;
+	startTime = 0;
+}
+
+AssetLoader::~AssetLoader()
+{
+	// Never leave a worker writing into a freed task. Anything
+	// not collected by now is released here.
+	for (auto& task : tasks)
+	{
+		if (task->done.valid())
+			task->done.wait();
+
+		if (!task->collected)
+		{
+			if (task->music)
+				Mix_FreeMusic(task->music);
+			if (task->chunk)
+				Mix_FreeChunk(task->chunk);
+		}
+	}
+}
+
+///
+/// Queueing
+///
+AssetLoader::Task* AssetLoader::Queue(const char* path, int kind)
+{
+	if (tasks.empty())
+		startTime = Profiler::Now();
+
+	Task* task = new Task();
+	task->path = path;
+	task->collected = 0;
+	task->music = nullptr;
+	task->chunk = nullptr;
+	task->duration = 0;
+	tasks.emplace_back(task);
+
+	task->done = workers.Push([task, kind]()
+	{
+		uint64_t start = Profiler::Now();
+
+		switch (kind)
+		{
+			case TASK_MUSIC:
+			{
+				PROFILE_ZONE("LoadMusic");
+				task->music = LoadMusic(task->path.c_str());
+				if (!task->music)
+					LOG_ERROR("%s: %s", task->path.c_str(), Mix_GetError());
+				break;
+			}
+			case TASK_CHUNK:
+			{
+				PROFILE_ZONE("LoadChunk");
+				task->chunk = LoadChunk(task->path.c_str());
+				if (!task->chunk)
+					LOG_ERROR("%s: %s", task->path.c_str(), Mix_GetError());
+				break;
+			}
+		}
+
+		task->duration = Profiler::Now() - start;
+	});
+
+	return task;
+}
+
+void AssetLoader::QueueMusic(const char* path)
+{
+	Queue(path, TASK_MUSIC);
+}
+
+void AssetLoader::QueueChunk(const char* path)
+{
+	Queue(path, TASK_CHUNK);
+}
+
+///
+/// Collecting
+///
+AssetLoader::Task* AssetLoader::Wait(const char* path)
+{
+	for (auto& task : tasks)
+	{
+		if (task->collected || task->path != path)
+			continue;
+
+		uint64_t start = Profiler::Now();
+		{
+			PROFILE_ZONE("WaitAsset");
+			task->done.wait();
+		}
+		totalWaited += Profiler::Now() - start;
+		totalWork += task->duration;
+
+		task->collected = 1;
+		return task.get();
+	}
+
+	return nullptr;
+}
+
+Mix_Music* AssetLoader::WaitMusic(const char* path)
+{
+	Task* task = Wait(path);
+	return task ? task->music : LoadMusic(path);
+}
+
+Mix_Chunk* AssetLoader::WaitChunk(const char* path)
+{
+	Task* task = Wait(path);
+	return task ? task->chunk : LoadChunk(path);
+}
+
+void AssetLoader::Report()
+{
+	LOG_INFO("Startup assets: %.1f ms of decoding, main thread waited %.1f ms, saved %.1f ms (%.1f ms since first queued)",
+		totalWork / 1e6, totalWaited / 1e6, ((int64_t)totalWork - (int64_t)totalWaited) / 1e6,
+		(Profiler::Now() - startTime) / 1e6);
+}
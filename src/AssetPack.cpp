@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include <AssetPack.h>
+#include <MappedFile.h>
+
+static_assert(sizeof(AssetPackEntry) == ASSET_PACK_NAME_SIZE + 16, "AssetPackEntry must not be padded");
+
+static MappedFile pack;
+static const AssetPackEntry *entries = nullptr;
+static uint32_t entryCount = 0;
+
+static bool NameLess(const AssetPackEntry &entry, const char *name)
+{
+	return strncmp(entry.name, name, ASSET_PACK_NAME_SIZE) < 0;
+}
+
+///
+/// Runtime
+///
+bool AssetPack::Open(const char *path)
+{
+	Close();
+
+	if (!pack.Open(path) || pack.Size() < sizeof(AssetPackHeader))
+	{
+		pack.Close();
+		return 0;
+	}
+
+	const AssetPackHeader *header = (const AssetPackHeader*)pack.Data();
+	const AssetPackEntry *index = (const AssetPackEntry*)(pack.Data() + sizeof(AssetPackHeader));
+
+	bool valid = header->magic == ASSET_PACK_MAGIC && header->version == ASSET_PACK_VERSION
+		&& sizeof(AssetPackHeader) + (uint64_t)header->count * sizeof(AssetPackEntry) <= pack.Size();
+
+	// Checked once here so Find() can trust the index
+	for (uint32_t i = 0; valid && i < header->count; ++i)
+	{
+		valid = index[i].name[ASSET_PACK_NAME_SIZE - 1] == '\0'
+			&& index[i].offset <= pack.Size() && index[i].size <= pack.Size() - index[i].offset
+			&& (i == 0 || strncmp(index[i - 1].name, index[i].name, ASSET_PACK_NAME_SIZE) < 0);
+	}
+
+	if (!valid)
+	{
+		pack.Close();
+		return 0;
+	}
+
+	entries = index;
+	entryCount = header->count;
+	return 1;
+}
+
+void AssetPack::Close()
+{
+	pack.Close();
+	entries = nullptr;
+	entryCount = 0;
+}
+
+bool AssetPack::Find(const char *name, const unsigned char *&data, size_t &size)
+{
+	if (!entries)
+		return 0;
+
+	const AssetPackEntry *entry = std::lower_bound(entries, entries + entryCount, name, NameLess);
+	if (entry == entries + entryCount || strncmp(entry->name, name, ASSET_PACK_NAME_SIZE) != 0)
+		return 0;
+
+	data = pack.Data() + entry->offset;
+	size = entry->size;
+	return 1;
+}
+
+///
+/// Building (offline tool)
+///
+static bool EntryLess(const AssetPackEntry &a, const AssetPackEntry &b)
+{
+	return strncmp(a.name, b.name, ASSET_PACK_NAME_SIZE) < 0;
+}
+
+static uint64_t Align(uint64_t offset)
+{
+	return (offset + ASSET_PACK_ALIGNMENT - 1) & ~(uint64_t)(ASSET_PACK_ALIGNMENT - 1);
+}
+
+bool AssetPack::Build(const char *path, const std::vector<std::string> &files, std::string &error)
+{
+	std::vector<AssetPackEntry> index(files.size());
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		if (files[i].size() >= ASSET_PACK_NAME_SIZE)
+		{
+			error = files[i] + ": name too long";
+			return 0;
+		}
+
+		memset(&index[i], 0, sizeof(AssetPackEntry));
+		memcpy(index[i].name, files[i].c_str(), files[i].size());
+	}
+
+	std::sort(index.begin(), index.end(), EntryLess);
+	for (size_t i = 1; i < index.size(); ++i)
+	{
+		if (!EntryLess(index[i - 1], index[i]))
+		{
+			error = std::string(index[i].name) + ": listed twice";
+			return 0;
+		}
+	}
+
+	// Written aside and renamed, so the game never maps a half-written pack
+	std::string temporary = std::string(path) + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file)
+	{
+		error = "cannot open " + temporary;
+		return 0;
+	}
+
+	AssetPackHeader header;
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.count = index.size();
+	header.reserved = 0;
+
+	// Contents go after the index, the index is rewritten once offsets are known
+	uint64_t offset = Align(sizeof(header) + index.size() * sizeof(AssetPackEntry));
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fseek(file, offset, SEEK_SET) == 0;
+
+	static const char padding[ASSET_PACK_ALIGNMENT] = {};
+	for (size_t i = 0; written && i < index.size(); ++i)
+	{
+		MappedFile source;
+		if (!source.Open(index[i].name))
+		{
+			// Empty files cannot be mapped, anything else is an error
+			FILE *empty = fopen(index[i].name, "rb");
+			if (!empty)
+			{
+				fclose(file);
+				remove(temporary.c_str());
+				error = std::string(index[i].name) + ": cannot read";
+				return 0;
+			}
+			fclose(empty);
+		}
+
+		index[i].offset = offset;
+		index[i].size = source.Size();
+
+		uint64_t next = Align(offset + source.Size());
+		written = (source.Size() == 0 || fwrite(source.Data(), source.Size(), 1, file) == 1)
+			&& (next == offset + source.Size() || fwrite(padding, next - offset - source.Size(), 1, file) == 1);
+		offset = next;
+	}
+
+	written = written && fseek(file, sizeof(header), SEEK_SET) == 0
+		&& (index.empty() || fwrite(&index[0], sizeof(AssetPackEntry), index.size(), file) == index.size());
+	written = (fclose(file) == 0) && written;
+
+	if (!written || rename(temporary.c_str(), path) < 0)
+	{
+		remove(temporary.c_str());
+		error = std::string("cannot write ") + path;
+		return 0;
+	}
+
+	return 1;
+}
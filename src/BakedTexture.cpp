@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <BakedTexture.h>
+
+#include "stb_image.h"
+
+static_assert(sizeof(BakedTextureHeader) == 40 + 8 * BAKED_TEXTURE_MAX_LEVELS, "BakedTextureHeader must not be padded");
+
+std::string BakedTexturePath(const char *source)
+{
+	return std::string(source) + BAKED_TEXTURE_EXTENSION;
+}
+
+static unsigned int LevelSize(unsigned int size, unsigned int level)
+{
+	size >>= level;
+	return size ? size : 1;
+}
+
+// Also builds, at load time, the levels an array layer has no baked file for
+void DownsampleTexture(const unsigned char *src, unsigned int srcWidth, unsigned int srcHeight,
+	unsigned char *dst, unsigned int dstWidth, unsigned int dstHeight)
+{
+	for (unsigned int y = 0; y < dstHeight; ++y)
+	{
+		unsigned int y0 = std::min(y * 2, srcHeight - 1);
+		unsigned int y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+		for (unsigned int x = 0; x < dstWidth; ++x)
+		{
+			unsigned int x0 = std::min(x * 2, srcWidth - 1);
+			unsigned int x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+			for (int c = 0; c < 4; ++c)
+			{
+				unsigned int sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c]
+					+ src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+				dst[(y * dstWidth + x) * 4 + c] = (sum + 2) / 4;
+			}
+		}
+	}
+}
+
+///
+/// Baking (offline tool)
+///
+bool BakeTexture(const char *source, std::string &error)
+{
+	struct stat info;
+	if (stat(source, &info) < 0)
+	{
+		error = "cannot stat source";
+		return 0;
+	}
+
+	// Always expanded to RGBA, whatever the source has
+	int width, height, channels;
+	unsigned char *pixels = stbi_load(source, &width, &height, &channels, 4);
+	if (!pixels)
+	{
+		error = stbi_failure_reason();
+		return 0;
+	}
+
+	BakedTextureHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = BAKED_TEXTURE_MAGIC;
+	header.version = BAKED_TEXTURE_VERSION;
+	header.width = width;
+	header.height = height;
+	header.sourceSize = info.st_size;
+	header.sourceTime = info.st_mtime;
+
+	unsigned int largest = std::max(width, height);
+	header.levels = 1;
+	while ((largest >> header.levels) && header.levels < BAKED_TEXTURE_MAX_LEVELS)
+		++header.levels;
+
+	// Every level, back to back
+	std::vector<unsigned char> levels;
+	uint64_t offset = sizeof(header);
+	for (unsigned int level = 0; level < header.levels; ++level)
+	{
+		header.levelOffset[level] = offset;
+		offset += (uint64_t)LevelSize(width, level) * LevelSize(height, level) * 4;
+	}
+	levels.resize(offset - sizeof(header));
+
+	memcpy(&levels[0], pixels, (size_t)width * height * 4);
+	stbi_image_free(pixels);
+
+	for (unsigned int level = 1; level < header.levels; ++level)
+	{
+		DownsampleTexture(&levels[header.levelOffset[level - 1] - sizeof(header)], LevelSize(width, level - 1), LevelSize(height, level - 1),
+			&levels[header.levelOffset[level] - sizeof(header)], LevelSize(width, level), LevelSize(height, level));
+	}
+
+	// Written aside and renamed, so the game never maps a half-written file
+	std::string path = BakedTexturePath(source);
+	std::string temporary = path + ".tmp";
+
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file)
+	{
+		error = "cannot open " + temporary;
+		return 0;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(&levels[0], levels.size(), 1, file) == 1;
+	written = (fclose(file) == 0) && written;
+
+	if (!written || rename(temporary.c_str(), path.c_str()) < 0)
+	{
+		remove(temporary.c_str());
+		error = "cannot write " + path;
+		return 0;
+	}
+
+	return 1;
+}
+
+///
+/// Validation (runtime)
+///
+const BakedTextureHeader* ValidateBakedTexture(const unsigned char *data, size_t size, const char *source)
+{
+	if (!data || size < sizeof(BakedTextureHeader))
+		return nullptr;
+
+	const BakedTextureHeader *header = (const BakedTextureHeader*)data;
+	if (header->magic != BAKED_TEXTURE_MAGIC || header->version != BAKED_TEXTURE_VERSION)
+		return nullptr;
+
+	if (!header->width || !header->height || !header->levels || header->levels > BAKED_TEXTURE_MAX_LEVELS)
+		return nullptr;
+
+	for (unsigned int level = 0; level < header->levels; ++level)
+	{
+		uint64_t levelSize = (uint64_t)LevelSize(header->width, level) * LevelSize(header->height, level) * 4;
+		if (header->levelOffset[level] < sizeof(BakedTextureHeader) || header->levelOffset[level] + levelSize > size)
+			return nullptr;
+	}
+
+	// Stale when the source changed since baking. A missing source
+	// is fine, the baked file may be all that was shipped.
+	struct stat info;
+	if (source && stat(source, &info) == 0)
+	{
+		if ((uint64_t)info.st_size != header->sourceSize || (int64_t)info.st_mtime != header->sourceTime)
+			return nullptr;
+	}
+
+	return header;
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <stdio.h>
+
+#include <BatchRunner.h>
+#include <Bot.h>
+#include <Simulation.h>
+#include <Profiler.h>
+#include <Logger.h>
+
+// Ten minutes of play
+#define BATCH_DEFAULT_MAX_TICKS (10 * 60 * 1000 / SIM_TICK_MS)
+
+BatchOptions::BatchOptions()
+{
+	games = 1000;
+	threads = 0;
+	difficulty = 0;
+	sides = TUNNEL_DEFAULT_SIDES;
+	seed = 1;
+	bot = "dodge";
+	maxTicks = BATCH_DEFAULT_MAX_TICKS;
+	csvPath = nullptr;
+}
+
+static void PlayGames(const BatchOptions &options, std::vector<BatchGame> &games, std::atomic<unsigned int> &next)
+{
+	Profiler::SetThreadName("BatchWorker");
+
+	std::unique_ptr<Bot> bot(CreateBot(options.bot));
+	Simulation simulation;
+
+	for (;;)
+	{
+		unsigned int i = next.fetch_add(1, std::memory_order_relaxed);
+		if (i >= games.size())
+			return;
+
+		BatchGame &game = games[i];
+		game.seed = Simulation::MixSeed(options.seed, i);
+		game.difficulty = options.difficulty ? options.difficulty : 1 + i % 3;
+
+		simulation.Reset(game.difficulty, game.seed, options.sides);
+		bot->Reset(game.difficulty, game.seed, options.sides);
+
+		bool hit = 0;
+		while (!hit && simulation.Tick() < options.maxTicks)
+			hit = simulation.Step(bot->Input(simulation.Track(), simulation.Rotation()));
+
+		game.score = simulation.Score();
+		game.ticks = simulation.Tick();
+		game.survived = !hit;
+	}
+}
+
+bool BatchRunner::Run(const BatchOptions &options)
+{
+	PROFILE_ZONE("BatchRun");
+
+	std::unique_ptr<Bot> probe(CreateBot(options.bot));
+	if (!probe)
+	{
+		LOG_ERROR("Unknown bot '%s', try dodge, random or idle", options.bot);
+		return 0;
+	}
+
+	unsigned int threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+	if (!threads)
+		threads = 1;
+	if (threads > options.games)
+		threads = options.games ? options.games : 1;
+
+	LOG_INFO("Playing %u games with the %s bot on %u threads, %u sided tunnel", options.games, options.bot, threads, options.sides);
+
+	std::vector<BatchGame> games(options.games);
+	std::atomic<unsigned int> next(0);
+
+	uint64_t start = Profiler::Now();
+	{
+		std::vector<std::thread> workers;
+		for (unsigned int t = 0; t < threads; ++t)
+			workers.push_back(std::thread(PlayGames, std::cref(options), std::ref(games), std::ref(next)));
+		for (std::thread &worker : workers)
+			worker.join();
+	}
+	double seconds = (Profiler::Now() - start) / 1e9;
+
+	Report(options, games, threads, seconds);
+
+	if (options.csvPath && !WriteCSV(options.csvPath, games))
+	{
+		LOG_ERROR("Failed to write %s", options.csvPath);
+		return 0;
+	}
+
+	return 1;
+}
+
+///
+/// Report
+///
+static double Percentile(const std::vector<double> &sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+}
+
+static void Distribution(const char *name, std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+
+	double sum = 0;
+	for (double v : values)
+		sum += v;
+
+	printf("  %-14s mean %10.1f  min %10.1f  p10 %10.1f  median %10.1f  p90 %10.1f  max %10.1f\n", name,
+		values.empty() ? 0.0 : sum / values.size(), Percentile(values, 0), Percentile(values, 0.1),
+		Percentile(values, 0.5), Percentile(values, 0.9), Percentile(values, 1));
+}
+
+void BatchRunner::Report(const BatchOptions &options, const std::vector<BatchGame> &games, unsigned int threads, double seconds)
+{
+	uint64_t ticks = 0;
+	for (const BatchGame &game : games)
+		ticks += game.ticks;
+
+	printf("%u games, %s bot, %u threads: %.3f s, %.0f games/s, %.0f ticks/s (%.0fx real time)\n",
+		(unsigned int)games.size(), options.bot, threads, seconds,
+		seconds > 0 ? games.size() / seconds : 0.0, seconds > 0 ? ticks / seconds : 0.0,
+		seconds > 0 ? ticks * SIM_TICK_MS / 1000.0 / seconds : 0.0);
+
+	for (unsigned short int d = 1; d <= 3; ++d)
+	{
+		std::vector<double> scores, survival;
+		unsigned int survived = 0;
+		for (const BatchGame &game : games)
+		{
+			if (game.difficulty != d)
+				continue;
+
+			scores.push_back(game.score);
+			survival.push_back(game.ticks * SIM_TICK_MS / 1000.0);
+			survived += game.survived;
+		}
+
+		if (scores.empty())
+			continue;
+
+		printf("Difficulty %u: %u games, %u survived %.0f s\n", d, (unsigned int)scores.size(), survived, options.maxTicks * SIM_TICK_MS / 1000.0);
+		Distribution("score", scores);
+		Distribution("survival (s)", survival);
+	}
+
+	fflush(stdout);
+}
+
+bool BatchRunner::WriteCSV(const char *path, const std::vector<BatchGame> &games)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return 0;
+
+	fputs("seed,difficulty,score,ticks,survived\n", file);
+	for (const BatchGame &game : games)
+		fprintf(file, "%u,%u,%u,%u,%d\n", game.seed, game.difficulty, game.score, game.ticks, game.survived ? 1 : 0);
+
+	return fclose(file) == 0;
+}
@@ -0,0 +1,133 @@
+#include <string.h>
+
+#include <Bot.h>
+#include <Simulation.h>
+
+// Shortest way around to 'target', in (-180, 180] degrees
+static Fixed AngleTo(Fixed rotation, Fixed target)
+{
+	Fixed diff = target - rotation;
+	if (diff > 180 * FIXED_ONE)
+		diff -= 360 * FIXED_ONE;
+	if (diff <= -180 * FIXED_ONE)
+		diff += 360 * FIXED_ONE;
+	return diff;
+}
+
+///
+/// Steers to the middle of the closest lane the next obstacle leaves
+/// open, and stays centered otherwise
+///
+class DodgeBot : public Bot
+{
+	private:
+		unsigned short int sides;
+
+		template <int Sides>
+		static int Steer(const ObstacleTrack &track, Fixed rotation)
+		{
+			typedef Tunnel<Sides> T;
+
+			int lane = T::Lane(rotation);
+
+			// Ones that can hit already are too late to dodge
+			ObstacleRange ahead = track.Ahead();
+			LaneMask blocked = ahead.empty() ? 0 : ahead[0].blocked;
+
+			if (T::Blocks(blocked, lane))
+			{
+				for (int step = 1; step <= Sides / 2; ++step)
+				{
+					if (!T::Blocks(blocked, (lane + step) % Sides))
+					{
+						lane = (lane + step) % Sides;
+						break;
+					}
+					if (!T::Blocks(blocked, (lane + Sides - step) % Sides))
+					{
+						lane = (lane + Sides - step) % Sides;
+						break;
+					}
+				}
+			}
+
+			// Within a degree of the center is close enough
+			Fixed diff = AngleTo(rotation, lane * T::laneWidth);
+			if (diff > FIXED_ONE)
+				return SIM_INPUT_RIGHT;
+			if (diff < -FIXED_ONE)
+				return SIM_INPUT_LEFT;
+			return 0;
+		}
+
+	public:
+		DodgeBot() : sides(TUNNEL_DEFAULT_SIDES) {}
+
+		void Reset(unsigned short int, uint32_t, unsigned short int s) { sides = s; }
+
+		int Input(const ObstacleTrack &track, Fixed rotation)
+		{
+			switch (sides)
+			{
+				case 4:
+					return Steer<4>(track, rotation);
+				case 8:
+					return Steer<8>(track, rotation);
+				default:
+					return Steer<6>(track, rotation);
+			}
+		}
+};
+
+///
+/// Holds a random direction for a random number of ticks
+///
+class RandomBot : public Bot
+{
+	private:
+		uint32_t random;
+		int input;
+		unsigned int hold;
+
+		uint32_t Next()
+		{
+			return Simulation::NextRandom(random);
+		}
+
+	public:
+		void Reset(unsigned short int, uint32_t seed, unsigned short int)
+		{
+			random = seed ? seed : 1;
+			input = 0;
+			hold = 0;
+		}
+
+		int Input(const ObstacleTrack&, Fixed)
+		{
+			if (!hold)
+			{
+				input = Next() % 3;
+				hold = 10 + Next() % 60;
+			}
+			--hold;
+			return input;
+		}
+};
+
+class IdleBot : public Bot
+{
+	public:
+		void Reset(unsigned short int, uint32_t, unsigned short int) {}
+		int Input(const ObstacleTrack&, Fixed) { return 0; }
+};
+
+Bot* CreateBot(const char* name)
+{
+	if (!strcmp(name, "dodge"))
+		return new DodgeBot();
+	if (!strcmp(name, "random"))
+		return new RandomBot();
+	if (!strcmp(name, "idle"))
+		return new IdleBot();
+	return nullptr;
+}
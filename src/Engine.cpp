@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <random>
+#include <stdlib.h> // atof, strtoul, strtoull
 
 #include <SDL.h>
 #include <SDL_mixer.h>
@@ -11,110 +13,359 @@
 
 #include <Engine.h>
 #include <Geometry.h>
+#include <AssetPack.h>
+#include <Profiler.h>
+#include <StartupProfile.h>
+#include <RenderMetrics.h>
+#include <AllocTracker.h>
+#include <Logger.h>
 
 #define SPEED_MULT 1 //6
 
+// Longer frames (a stall, a dragged window) are played as this long,
+// rather than catching up in one jump
+#define MAX_FRAME_MS 100
+
 ///
 /// Startup & shutdown
 ///
 bool Engine::Initialize(int argc, char *argv[])
 {
+	Profiler::SetThreadName("Main");
+	STARTUP_PHASE("Initialize");
+
 	// Prepare log file
-	logFile.open("log.txt", std::ofstream::out | std::ofstream::app);
-	Log("--- LAUNCHING GAME ---");
+	Logger::Start("log.txt");
+	LOG_INFO("--- LAUNCHING GAME ---");
 
-	// Initialize SDL
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+	// Shutdown() frees these even when initialization fails
+	gameWindow = nullptr;
+	gameContext = nullptr;
+	gameMusic = nullptr;
+	gameHit = gameSelect = nullptr;
+	gameState = 0;
+	tickTime = 0;
+	tunnelSides = TUNNEL_DEFAULT_SIDES;
+
+	// Command line options
+	startupBenchmark = nullptr;
+	recordPrefix = nullptr;
+	recordedGames = 0;
+	replaying = headless = replayMatched = batching = analyzing = 0;
+	autoplay = hiddenWindow = 0;
+	const char* replayPath = nullptr;
+	const char* botName = nullptr;
+	for (int i = 1; i < argc; ++i)
 	{
-		Log("ERROR: Failed to initialize SDL...");
-		Log(SDL_GetError());
-		return 0;
+		// Frames slower than this many times the median are logged
+		if (std::string(argv[i]) == "--spike-budget" && i + 1 < argc)
+			stutterDetector.SetBudget(atof(argv[++i]));
+
+		// GPU memory screen textures may keep resident, in MB
+		else if (std::string(argv[i]) == "--texture-budget" && i + 1 < argc)
+			geometryHandler.SetTextureBudget(atof(argv[++i]) * 1048576.0);
+
+		// Highscores kept per difficulty, the menu shows the first few
+		else if (std::string(argv[i]) == "--highscore-depth" && i + 1 < argc)
+			geometryHandler.SetHighscoreDepth(atoi(argv[++i]));
+
+		// Hidden window, quits after the first frame of the menu and
+		// appends its startup phases to startup.csv under this label
+		else if (std::string(argv[i]) == "--startup-benchmark" && i + 1 < argc)
+			startupBenchmark = argv[++i];
+		else if (std::string(argv[i]) == "--hidden")
+			hiddenWindow = 1;
+
+		// Units ahead the level is generated to, 100 by default
+		else if (std::string(argv[i]) == "--lookahead" && i + 1 < argc)
+			simulation.SetLookahead(atof(argv[++i]) * FIXED_ONE);
+
+		// Writes each game's seed and inputs to <prefix>-<n>.isr
+		else if (std::string(argv[i]) == "--record" && i + 1 < argc)
+			recordPrefix = argv[++i];
+
+		// Plays a recorded game back, with --headless as fast as possible
+		else if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+			replayPath = argv[++i];
+		else if (std::string(argv[i]) == "--headless")
+			headless = 1;
+
+		// Tunnel with 4, 6 or 8 sides
+		else if (std::string(argv[i]) == "--sides" && i + 1 < argc)
+			tunnelSides = atoi(argv[++i]);
+
+		// A bot plays instead of the keyboard: dodge, random or idle.
+		// With --difficulty (and --max-seconds) it plays one game in
+		// the window by itself, then quits.
+		else if (std::string(argv[i]) == "--bot" && i + 1 < argc)
+			botName = argv[++i];
+
+		// Plays this many headless bot games and reports their scores,
+		// survival times and throughput. The options below tune it.
+		else if (std::string(argv[i]) == "--batch" && i + 1 < argc)
+		{
+			batchOptions.games = atoi(argv[++i]);
+			batching = 1;
+		}
+		else if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+			batchOptions.threads = atoi(argv[++i]);
+		else if (std::string(argv[i]) == "--seed" && i + 1 < argc)
+			batchOptions.seed = strtoul(argv[++i], nullptr, 10);
+		else if (std::string(argv[i]) == "--difficulty" && i + 1 < argc)
+			batchOptions.difficulty = atoi(argv[++i]);
+		else if (std::string(argv[i]) == "--max-seconds" && i + 1 < argc)
+			batchOptions.maxTicks = atof(argv[++i]) * 1000 / SIM_TICK_MS;
+		else if (std::string(argv[i]) == "--batch-csv" && i + 1 < argc)
+			batchOptions.csvPath = argv[++i];
+
+		// Generates this many obstacle sequences and reports how many
+		// can't be survived. Takes --threads, --seed and --difficulty.
+		else if (std::string(argv[i]) == "--analyze-levels" && i + 1 < argc)
+		{
+			analysisOptions.sequences = strtoull(argv[++i], nullptr, 10);
+			analyzing = 1;
+		}
+		else if (std::string(argv[i]) == "--sequence-length" && i + 1 < argc)
+			analysisOptions.length = atoi(argv[++i]);
 	}
 
-	//Initialize SDL_mixer
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096) < 0)
+	if (tunnelSides != 4 && tunnelSides != 6 && tunnelSides != 8)
 	{
-		Log("SDL_mixer could not initialize! SDL_mixer Error:");
-		Log(Mix_GetError());
+		LOG_ERROR("--sides must be 4, 6 or 8");
 		return 0;
 	}
-	
-	if (Mix_Init(MIX_INIT_MP3) != MIX_INIT_MP3)
-    {
-    	Log("SDL_mixer could not initialize! SDL_mixer Error:");
-		Log(Mix_GetError());
-		return 0;
-    }
 
-	//Load media
-	if(LoadMedia())
+	if (botName)
 	{
-		Log("Media loaded successfully!");
+		bot.reset(CreateBot(botName));
+		if (!bot)
+		{
+			LOG_ERROR("Unknown bot '%s', try dodge, random or idle", botName);
+			return 0;
+		}
+		batchOptions.bot = botName;
 	}
-	else
+
+	if (batching || analyzing)
 	{
-		Log("Failed to load media!");
+		if (batchOptions.difficulty > 3)
+		{
+			LOG_ERROR("--difficulty must be 1 to 3, or 0 for all of them");
+			return 0;
+		}
+		analysisOptions.threads = batchOptions.threads;
+		analysisOptions.seed = batchOptions.seed;
+		analysisOptions.difficulty = batchOptions.difficulty;
+		analysisOptions.sides = batchOptions.sides = tunnelSides;
+		headless = 1;
+		return 1;
 	}
 
-	/// OpenGL options & SDL window creation
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	if (replayPath)
+	{
+		std::string error;
+		if (!playback.Load(replayPath, error))
+		{
+			LOG_ERROR("%s: %s", replayPath, error.c_str());
+			return 0;
+		}
+		replaying = 1;
+	}
 
-	gameWindow = SDL_CreateWindow("Infinity Spectrum", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, SDL_WINDOW_OPENGL);
-	gameContext = SDL_GL_CreateContext(gameWindow);
-	gameState = 0;
+	// Nothing but the simulation
+	if (headless)
+	{
+		if (!replaying && !bot)
+		{
+			LOG_ERROR("--headless needs --replay <file> or --bot <name>");
+			return 0;
+		}
+		if (!replaying && (batchOptions.difficulty < 1 || batchOptions.difficulty > 3))
+		{
+			LOG_ERROR("--headless --bot needs --difficulty 1 to 3");
+			return 0;
+		}
+		return 1;
+	}
 
-	if (!gameContext)
+	if (bot && !replaying && batchOptions.difficulty)
 	{
-		Log("ERROR: Failed to create GLContext...");
-		Log(SDL_GetError());
-		return 0;
+		if (batchOptions.difficulty > 3)
+		{
+			LOG_ERROR("--bot needs --difficulty 1 to 3");
+			return 0;
+		}
+		autoplay = 1;
+	}
+
+	// Initialize SDL
+	{
+		STARTUP_PHASE("Init.SDL");
+		if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+		{
+			LOG_ERROR("Failed to initialize SDL: %s", SDL_GetError());
+			return 0;
+		}
+	}
+
+	//Initialize SDL_mixer
+	{
+		STARTUP_PHASE("Init.Audio");
+		if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096) < 0)
+		{
+			LOG_ERROR("SDL_mixer could not initialize! SDL_mixer Error: %s", Mix_GetError());
+			return 0;
+		}
+
+		if (Mix_Init(MIX_INIT_MP3) != MIX_INIT_MP3)
+		{
+			LOG_ERROR("SDL_mixer could not initialize! SDL_mixer Error: %s", Mix_GetError());
+			return 0;
+		}
+	}
+
+	// Assets come from the pack when there is one, loose files otherwise
+	{
+		STARTUP_PHASE("Init.AssetPack");
+		if (AssetPack::Open(ASSET_PACK_PATH))
+			LOG_INFO("Using asset pack %s", ASSET_PACK_PATH);
+	}
+
+	// Decode images and audio on worker threads while the
+	// window, GL context and shaders are set up
+	assetLoader.QueueMusic("res/music.mp3");
+	assetLoader.QueueChunk("res/hit.wav");
+	assetLoader.QueueChunk("res/select.wav");
+	geometryHandler.QueueTextures();
+
+	/// OpenGL options & SDL window creation
+	{
+		STARTUP_PHASE("Init.Window");
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+		Uint32 windowFlags = SDL_WINDOW_OPENGL;
+		if (startupBenchmark || hiddenWindow)
+			windowFlags |= SDL_WINDOW_HIDDEN;
+
+		gameWindow = SDL_CreateWindow("Infinity Spectrum", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 720, windowFlags);
+		gameContext = SDL_GL_CreateContext(gameWindow);
+		showOverlay = 0;
+
+		if (!gameContext)
+		{
+			LOG_ERROR("Failed to create GLContext: %s", SDL_GetError());
+			return 0;
+		}
 	}
 
 	// Pointer to keyboard state
 	keystate = SDL_GetKeyboardState(NULL);
 
 	// More OpenGL options, after context creation
-	glutInit(&argc, argv);
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-	
+	{
+		STARTUP_PHASE("Init.GLUT");
+		glutInit(&argc, argv);
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+	}
+
 	// Game geometry setup
-	geometryHandler.InitMatrixes();
-	geometryHandler.InitShaders();
-	geometryHandler.InitGeometry();
-	geometryHandler.InitFonts();
+	{
+		STARTUP_PHASE("Init.Geometry");
+		geometryHandler.InitMatrixes();
+		geometryHandler.InitShaders();
+
+		// Something on screen while textures, fonts and
+		// media finish and the driver compiles shaders
+		glClearColor(0.0, 0.0, 0.3, 1.0);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		geometryHandler.DrawLoading();
+		SDL_GL_SwapWindow(gameWindow);
+		StartupProfile::FramePresented(1);
+
+		geometryHandler.InitGeometry();
+		geometryHandler.InitFonts();
+	}
+
+	//Load media
+	if(LoadMedia())
+	{
+		LOG_INFO("Media loaded successfully!");
+	}
+	else
+	{
+		LOG_ERROR("Failed to load media!");
+	}
+	assetLoader.Report();
 
 	// Successfully initialized
-	Log("LOG: OpenGL window initialized");
-	std::cout << glGetString(GL_VERSION) << std::endl;
+	LOG_INFO("OpenGL window initialized: %s", glGetString(GL_VERSION));
 
 	return 1;
 }
 
-void Engine::Shutdown()
+bool Engine::Shutdown()
 {
-	Log("--- SHUTTING DOWN ---");
-	logFile.close();
+	LOG_INFO("--- SHUTTING DOWN ---");
+
+	// Save recorded zones for chrome://tracing or Perfetto
+	if (!Profiler::Dump("profile.json"))
+		LOG_ERROR("Failed to write profile.json");
+
+	if (!RenderMetrics::DumpCSV("metrics.csv"))
+		LOG_ERROR("Failed to write metrics.csv");
+
+	bool allocsClean = 1;
+	if (AllocTracker::Enabled())
+	{
+		allocsClean = AllocTracker::Violations() == 0;
+		if (allocsClean)
+			LOG_INFO("No gameplay frame allocated");
+		else
+			LOG_ERROR("%lu gameplay frames allocated, see allocations.txt", AllocTracker::Violations());
+		if (!AllocTracker::DumpReport("allocations.txt"))
+			LOG_ERROR("Failed to write allocations.txt");
+	}
+
+	LOG_INFO("%lu frame time spikes, see spikes.log", stutterDetector.Spikes());
+	if (!stutterDetector.DumpLog("spikes.log"))
+		LOG_ERROR("Failed to write spikes.log");
+
+	// A game quit halfway through is still worth keeping
+	SaveRecording();
+	recorder.Wait();
+
+	// Before the logger stops, the writer logs how saving went
+	geometryHandler.SaveHighscores();
 
 	// Release resources
-	//Free sound effects
-	Mix_FreeChunk(gameHit);
-	Mix_FreeChunk(gameSelect);
-	gameHit = nullptr;
-	gameSelect = nullptr;
-
-	//Free music
-	Mix_FreeMusic(gameMusic);
-	gameMusic = nullptr;
-	Mix_CloseAudio();
-	Mix_Quit();
+	if (!headless)
+	{
+		//Free sound effects
+		Mix_FreeChunk(gameHit);
+		Mix_FreeChunk(gameSelect);
+		gameHit = nullptr;
+		gameSelect = nullptr;
+
+		//Free music
+		Mix_FreeMusic(gameMusic);
+		gameMusic = nullptr;
+		Mix_CloseAudio();
+		Mix_Quit();
+
+		// Only once nothing streams from it anymore
+		AssetPack::Close();
+
+		SDL_GL_DeleteContext(gameContext);
+		SDL_DestroyWindow(gameWindow);
+		SDL_Quit();
+	}
 
-	SDL_GL_DeleteContext(gameContext);
-	SDL_DestroyWindow(gameWindow);
-	SDL_Quit();
+	Logger::Stop();
+	return allocsClean;
 }
 
 ///
@@ -122,13 +373,30 @@ void Engine::Shutdown()
 ///
 bool Engine::GameLoop()
 {
-	Log("LOG: Entering game loop");
+	if (analyzing && !LevelAnalyzer::Run(analysisOptions))
+		return 0;
+	if (batching)
+		return BatchRunner::Run(batchOptions);
+	if (analyzing)
+		return 1;
+	if (headless)
+		return RunHeadless();
+
+	LOG_INFO("Entering game loop");
 	SDL_Event event;
 	bool keepRunning = 1;
 	tickStart = glutGet(GLUT_ELAPSED_TIME); //SDL_GetTicks();
 
+	// The keyboard only takes over once the replay ended
+	if (replaying)
+		StartGame(playback.Difficulty(), playback.Seed(), playback.Sides());
+
 	while (keepRunning)
 	{
+		PROFILE_ZONE("Frame");
+		uint64_t frameStart = Profiler::Now();
+		unsigned short int frameState = gameState;
+
 		tickEnd = tickStart;
 		tickStart = glutGet(GLUT_ELAPSED_TIME); //SDL_GetTicks();
 		while (SDL_PollEvent(&event))
@@ -144,47 +412,12 @@ bool Engine::GameLoop()
 				{
 				// Difficulty select
 				case SDLK_1:
-					if (gameState == 0)
-					{
-						//Play select sound effect
-						Mix_PlayChannel(-1, gameSelect, 0);
-						gameState = 3;
-						geometryHandler.SetDifficulty(1);
-
-						//Play music
-						Mix_PlayMusic( gameMusic, -1 );
-						if (Mix_PlayMusic(gameMusic, -1) == -1)
-							Log(Mix_GetError());
-					}
-					break;
-
 				case SDLK_2:
-					if (gameState == 0)
-					{
-						//Play select sound effect
-						Mix_PlayChannel(-1, gameSelect, 0);
-						gameState = 3;
-						geometryHandler.SetDifficulty(2);
-
-						//Play music
-						Mix_PlayMusic( gameMusic, -1 );
-						if (Mix_PlayMusic(gameMusic, -1) == -1)
-							Log(Mix_GetError());
-					}
-					break;
-
 				case SDLK_3:
 					if (gameState == 0)
 					{
-						//Play select sound effect
-						Mix_PlayChannel(-1, gameSelect, 0);
-						gameState = 3;
-						geometryHandler.SetDifficulty(3);
-
-						//Play music
-						Mix_PlayMusic( gameMusic, -1 );
-						if (Mix_PlayMusic(gameMusic, -1) == -1)
-							Log(Mix_GetError());
+						unsigned short int difficulty = event.key.keysym.sym == SDLK_1 ? 1 : event.key.keysym.sym == SDLK_2 ? 2 : 3;
+						StartGame(difficulty, std::random_device()(), tunnelSides);
 					}
 					break;
 
@@ -195,6 +428,26 @@ bool Engine::GameLoop()
 						gameState = 0;
 					break;
 
+				// Render metrics
+				case SDLK_F3:
+					showOverlay = !showOverlay;
+					break;
+
+				case SDLK_F11:
+					if (RenderMetrics::DumpCSV("metrics.csv"))
+						LOG_INFO("Render metrics written to metrics.csv");
+					else
+						LOG_ERROR("Failed to write metrics.csv");
+					break;
+
+				// Dump profiler zones recorded so far
+				case SDLK_F12:
+					if (Profiler::Dump("profile.json"))
+						LOG_INFO("Profile written to profile.json");
+					else
+						LOG_ERROR("Failed to write profile.json");
+					break;
+
 				// Quit
 				case SDLK_q:
 				case SDLK_ESCAPE:
@@ -206,108 +459,289 @@ bool Engine::GameLoop()
 			}
 		}
 
+		// The bot's game starts once the menu can be drawn, so it
+		// goes through the same rendering as a player's
+		if (autoplay && gameState == 0 && geometryHandler.ShadersReady())
+			StartGame(batchOptions.difficulty, batchOptions.seed, tunnelSides);
+
 		// Run game logic & draw onto screen
-		Update(SDL_TICKS_PASSED(tickStart, tickEnd) * SPEED_MULT);
-		if (Draw())
+		Update(FrameTime());
+		Draw();
+
+		// Bots can play forever, they stop after --max-seconds
+		if (autoplay && gameState == 3 && simulation.Tick() >= batchOptions.maxTicks)
+			EndGame(0);
+		if (autoplay && gameState == 1)
+			keepRunning = 0;
+
+		// Startup measured, nothing else to do
+		if (startupBenchmark && StartupProfile::Complete())
 		{
-			//Play sound effect when hitting an obstacle
-			Mix_PlayChannel(-1, gameHit, 0 );
-			gameState = 1;
-			//Stop Music
-			Mix_HaltMusic();	
+			if (!StartupProfile::AppendCSV("startup.csv", startupBenchmark))
+				LOG_ERROR("Failed to write startup.csv");
+			keepRunning = 0;
 		}
+
+		// Gameplay frames that neither start nor end a
+		// game are expected to leave the heap alone
+		AllocTracker::ExpectNoAllocs(frameState == 3 && gameState == 3);
+		AllocFrameStats allocStats = AllocTracker::EndFrame();
+
+		// Flag hitches and blame the zone that overran
+		SpikeContext spikeContext;
+		spikeContext.gameState = gameState;
+		spikeContext.obstacles = simulation.Track().Size();
+		spikeContext.allocs = allocStats.allocs;
+		stutterDetector.EndFrame(frameStart, Profiler::Now(), spikeContext);
 	}
 
-	Log("LOG: Exiting game loop");
+	LOG_INFO("Exiting game loop");
 	return 1;
 }
 
 ///
 /// Game logic
 ///
-void Engine::Update(Uint32 elapsedTime)
+void Engine::StartGame(unsigned short int difficulty, uint32_t seed, unsigned short int sides)
 {
-	if (keystate[SDL_SCANCODE_RIGHT])
+	if (!headless)
 	{
-		geometryHandler.Rotate(elapsedTime, 1);
+		//Play select sound effect
+		Mix_PlayChannel(-1, gameSelect, 0);
+
+		//Play music
+		PlayMusic();
 	}
 
-	if (keystate[SDL_SCANCODE_LEFT])
+	LOG_INFO("Game started. Difficulty %u, seed %u, %u sides", difficulty, seed, sides);
+
+	gameState = 3;
+	tickTime = 0;
+	simulation.Reset(difficulty, seed, sides);
+	if (bot)
+		bot->Reset(difficulty, seed, sides);
+
+	if (recordPrefix && !replaying)
+		recorder.Begin(seed, difficulty, sides);
+}
+
+void Engine::EndGame(bool hit)
+{
+	if (!headless)
 	{
-		geometryHandler.Rotate(elapsedTime, -1);
+		//Play sound effect when hitting an obstacle
+		if (hit)
+			Mix_PlayChannel(-1, gameHit, 0);
+
+		//Stop Music
+		Mix_HaltMusic();
 	}
 
-	/*if (keystate[SDL_SCANCODE_UP])
+	gameState = 1;
+
+	// Replays are checked, not scored
+	if (replaying)
 	{
-		geometryHandler.Move(elapsedTime, 1);
+		CheckReplay();
+		replaying = 0;
+		return;
 	}
 
-	if (keystate[SDL_SCANCODE_DOWN])
+	// The tables are for people playing the hexagon
+	if (!bot && simulation.Sides() == TUNNEL_DEFAULT_SIDES)
+		geometryHandler.SubmitScore(simulation.Difficulty(), simulation.Score());
+	SaveRecording();
+}
+
+void Engine::SaveRecording()
+{
+	if (!recorder.Recording())
+		return;
+
+	std::string path = std::string(recordPrefix) + "-" + std::to_string(++recordedGames) + REPLAY_EXTENSION;
+	recorder.Save(path.c_str(), simulation.Tick(), simulation.Score());
+}
+
+// Same seed and inputs must end the same way
+void Engine::CheckReplay()
+{
+	replayMatched = simulation.Tick() == playback.Ticks() && simulation.Score() == playback.Score();
+
+	if (replayMatched)
+		LOG_INFO("Replay matches: %u ticks, score %u", simulation.Tick(), simulation.Score());
+	else
 	{
-		geometryHandler.Move(elapsedTime, -1);
-	}*/
+		LOG_ERROR("Replay diverged: ended at tick %u with score %u, recorded tick %u with score %u",
+			simulation.Tick(), simulation.Score(), playback.Ticks(), playback.Score());
+	}
+}
+
+// Milliseconds since the previous frame began
+Uint32 Engine::FrameTime() const
+{
+	Uint32 elapsed = (tickStart - tickEnd) * SPEED_MULT;
+	return elapsed < MAX_FRAME_MS ? elapsed : MAX_FRAME_MS;
+}
+
+void Engine::Update(Uint32 elapsedTime)
+{
+	PROFILE_ZONE("Update");
+
+	if (gameState != 3)
+		return;
+
+	// Keys are read once per frame, and held for all of its ticks
+	int input = 0;
+	if (!replaying && !bot)
+	{
+		if (keystate[SDL_SCANCODE_LEFT])
+			input |= SIM_INPUT_LEFT;
+		if (keystate[SDL_SCANCODE_RIGHT])
+			input |= SIM_INPUT_RIGHT;
+	}
+
+	tickTime += elapsedTime;
+	while (tickTime >= SIM_TICK_MS && gameState == 3)
+	{
+		tickTime -= SIM_TICK_MS;
+
+		if (replaying)
+		{
+			// Recorded until the player quit, not until a hit
+			if (simulation.Tick() >= playback.Ticks())
+			{
+				EndGame(0);
+				break;
+			}
+			input = playback.Input(simulation.Tick());
+		}
+		else if (bot)
+			input = bot->Input(simulation.Track(), simulation.Rotation());
+
+		recorder.Record(simulation.Tick(), input);
+		if (simulation.Step(input))
+			EndGame(1);
+	}
+}
+
+// Whole replay, or one bot game, in one go: no window, audio or
+// frame pacing
+bool Engine::RunHeadless()
+{
+	PROFILE_ZONE("RunHeadless");
+
+	uint64_t start = Profiler::Now();
+
+	// EndGame() clears 'replaying'
+	bool replay = replaying;
+	if (replay)
+		StartGame(playback.Difficulty(), playback.Seed(), playback.Sides());
+	else
+		StartGame(batchOptions.difficulty, batchOptions.seed, tunnelSides);
+
+	// Starting a game may allocate, playing it may not
+	AllocTracker::ExpectNoAllocs(0);
+	AllocTracker::EndFrame();
+
+	while (gameState == 3)
+	{
+		// Bots can play forever, they stop after --max-seconds
+		uint32_t ticks = 1024;
+		if (!replaying && batchOptions.maxTicks - simulation.Tick() < ticks)
+			ticks = batchOptions.maxTicks - simulation.Tick();
+		if (!ticks)
+		{
+			EndGame(0);
+			break;
+		}
+
+		// Each call stands in for a frame, held to the same rule
+		// as the game loop's
+		Update(ticks * SIM_TICK_MS);
+		AllocTracker::ExpectNoAllocs(gameState == 3);
+		AllocTracker::EndFrame();
+	}
+
+	double played = simulation.Tick() * SIM_TICK_MS / 1000.0;
+	double took = (Profiler::Now() - start) / 1e9;
+	LOG_INFO("Played %.1f s of game in %.3f s (%.0fx real time), score %u", played, took, took > 0 ? played / took : 0.0, simulation.Score());
+
+	return replay ? replayMatched : 1;
 }
 
 ///
 /// OpenGL calls
 ///
-int Engine::Draw()
+void Engine::Draw()
 {
+	PROFILE_ZONE("Draw");
+
 	// Clear the screen
 	glClearColor(0.0, 0.0, 0.3, 1.0);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Draw 3d geometry
-	int result = geometryHandler.Draw(SDL_TICKS_PASSED(tickStart, tickEnd) * SPEED_MULT, gameState);
+	// Draw 3d geometry, or the loading screen until shaders are linked
+	bool loading = !geometryHandler.ShadersReady();
+	if (!loading)
+		geometryHandler.Draw(FrameTime(), gameState, simulation);
+	else
+		geometryHandler.DrawLoading();
+
+	if (showOverlay)
+		geometryHandler.DrawOverlay();
 
 	// Swap buffers
-	SDL_GL_SwapWindow(gameWindow);
+	{
+		PROFILE_ZONE("Swap");
+		SDL_GL_SwapWindow(gameWindow);
+	}
+
+	if (!StartupProfile::Complete())
+	{
+		StartupProfile::FramePresented(loading);
+		if (StartupProfile::Complete())
+			StartupProfile::Report();
+	}
 
-	return result;
+	RenderMetrics::EndFrame();
 }
 
-///
-/// Basic logging support
-///
-bool Engine::Log(std::string msg)
+void Engine::PlayMusic()
 {
-	if (!logFile)
-		return 0;
-
-	logFile << msg << '\n';
-	std::cout << msg << std::endl;
+	PROFILE_ZONE("PlayMusic");
 
-	return 1;
+	if (Mix_PlayMusic(gameMusic, -1) == -1)
+		LOG_ERROR("Failed to play music: %s", Mix_GetError());
 }
 
 bool Engine::LoadMedia()
 {
+	STARTUP_PHASE("LoadMedia");
+
 	//Loading success flag 
 	bool success = true; 
 
+	// Decoded by the asset loader, which logs SDL_mixer's error
 	//Load music 
-	gameMusic = Mix_LoadMUS("res/music.mp3");
+	gameMusic = assetLoader.WaitMusic("res/music.mp3");
 	if (gameMusic == nullptr) 
 	{ 
-		Log("Failed to load music. SDL_mixer Error: ");
-		Log(Mix_GetError());
+		LOG_ERROR("Failed to load music.");
 		success = false;
 	}
 
 	//Load sound effects
-	gameHit = Mix_LoadWAV("res/hit.wav");
+	gameHit = assetLoader.WaitChunk("res/hit.wav");
 	if (gameHit == nullptr)
 	{
-		Log("Failed to load hit obstacle sound effect. SDL_mixer Error: ");
-		Log(Mix_GetError());
+		LOG_ERROR("Failed to load hit obstacle sound effect.");
 		success = false;
 	}
 
-	gameSelect = Mix_LoadWAV("res/select.wav");
+	gameSelect = assetLoader.WaitChunk("res/select.wav");
 	if (gameSelect == nullptr)
 	{
-		Log("Failed to load select menu option sound effect. SDL_mixer Error: ");
-		Log(Mix_GetError());
+		LOG_ERROR("Failed to load select menu option sound effect.");
 		success = false;
 	}
 
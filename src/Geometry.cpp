@@ -4,8 +4,9 @@
 
 #include <math.h> // pow
 #include <stdlib.h> // rand
+#include <stdio.h> // snprintf
+#include <string.h> // strcmp
 #include <iostream>
-#include <sstream>
 #include <string>
 #include <fstream>
 
@@ -14,12 +15,31 @@
 #include <GL/gl.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+
+// Route glText's heap use through the allocation tracker
+#ifdef TRACK_ALLOCS
+#include <AllocTracker.h>
+#define malloc(size) TrackedMalloc(size)
+#define calloc(count, size) TrackedCalloc(count, size)
+#define free(ptr) TrackedFree(ptr)
+#endif
+
 #include <gltext.h>
 
+#ifdef TRACK_ALLOCS
+#undef malloc
+#undef calloc
+#undef free
+#endif
+
 #include <ShaderLoader.h>
 #include <TextureLoader.h>
 #include <Geometry.h>
 #include <Color.h>
+#include <Profiler.h>
+#include <StartupProfile.h>
+#include <Logger.h>
+#include <RenderMetrics.h>
 
 ///
 /// Matrixes
@@ -27,7 +47,7 @@
 void Geometry::InitMatrixes()
 {
 	// Projection matrix : 90° Field of View, 16:9 aspect ratio, display range: 0.1 unit <-> 100 units
-	projectionMatrix = glm::perspective(glm::radians(90.0f), 16.0f/9.0f, 0.1f, 100.0f);
+	projectionMatrix = glm::perspective(glm::radians(90.0f), 16.0f/9.0f, 0.1f, (float)FAR_PLANE);
 
 	// View matrix: camera at (0,-1.5,5) looks at (0,-1.5,0), Y is up (0, 1, 0)
 	//viewMatrix = glm::lookAt(glm::vec3(0, -1.62, 5), glm::vec3(0, -1.5, 0), glm::vec3(0, 1, 0));
@@ -38,16 +58,74 @@ void Geometry::InitMatrixes()
 
 	// Pipeline matrix: all of the previous, put together
 	pipelineMatrix = projectionMatrix * viewMatrix * modelMatrix;
+
+	// Menu and game over images
+	screenMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.85f));
+	screenMatrix = glm::scale(screenMatrix, glm::vec3(9.f, 9.f, 1.f));
+	screenMatrix = glm::rotate(screenMatrix, -90 * ((float)PI/180), glm::vec3(1.f, 0.f, 0.f));
+
+	shipMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.5f, 4.f));
+	shipMatrix = glm::scale(shipMatrix, glm::vec3(0.1f, 0.1f, 0.1f));
+	//shipMatrix = glm::translate(shipMatrix, glm::vec3(0.0f, -1.7f, 4.85f));
+	//shipMatrix = glm::scale(shipMatrix, glm::vec3(0.02f, 0.02f, 0.02f));
+	shipMatrix = glm::rotate(shipMatrix, -90 * ((float)PI/180), glm::vec3(1.f, 0.f, 0.f));
+	shipMatrix = glm::rotate(shipMatrix, 45 * ((float)PI/180), glm::vec3(0.f, 1.f, 0.f));
 }
 
 ///
 /// Shaders
 ///
+// Full screen triangle from gl_VertexID and a progress bar,
+// so it needs no buffers and compiles in no time
+static const char *loadingVertexShader =
+	"#version 330 core\n"
+	"out vec2 uv;\n"
+	"void main()\n"
+	"{\n"
+	"    uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const char *loadingFragmentShader =
+	"#version 330 core\n"
+	"uniform float progress;\n"
+	"in vec2 uv;\n"
+	"out vec4 finalColor;\n"
+	"void main()\n"
+	"{\n"
+	"    bool bar = abs(uv.y - 0.1) < 0.01 && abs(uv.x - 0.5) < 0.3;\n"
+	"    bool filled = uv.x - 0.2 < 0.6 * progress;\n"
+	"    finalColor = bar ? (filled ? vec4(1.0) : vec4(0.2, 0.2, 0.4, 1.0)) : vec4(0.0, 0.0, 0.3, 1.0);\n"
+	"}\n";
+
 void Geometry::InitShaders()
 {
-	// Compile shaders
-	shaderProgramID[0] = LoadShaders("res/vertexShader.vert", "res/fragmentShader.frag");
-	shaderProgramID[1] = LoadShaders("res/vertexShader.vert", "res/fragmentShader2.frag");
+	STARTUP_PHASE("InitShaders");
+
+	// Submit both programs up front, the driver compiles
+	// them while the rest of the game loads
+	BeginLoadShaders("res/vertexShader.vert", "res/fragmentShader.frag", shaderBuilds[0]);
+	BeginLoadShaders("res/vertexShader.vert", "res/fragmentShader2.frag", shaderBuilds[1]);
+	shadersReady = 0;
+
+	loadingProgramID = LoadShaderSource(loadingVertexShader, loadingFragmentShader);
+	loadingProgressID = glGetUniformLocation(loadingProgramID, "progress");
+	glGenVertexArrays(1, &loadingVAO);
+}
+
+bool Geometry::ShadersReady()
+{
+	if (shadersReady)
+		return 1;
+
+	for (int i = 0; i < MAX_SHADERS; ++i)
+		if (!IsShaderProgramReady(shaderBuilds[i]))
+			return 0;
+
+	PROFILE_ZONE("FinishShaders");
+
+	for (int i = 0; i < MAX_SHADERS; ++i)
+		shaderProgramID[i] = FinishLoadShaders(shaderBuilds[i]);
 
 	// Get a handle for the uniforms inside our shaders
 	uniformID[0] = glGetUniformLocation(shaderProgramID[0], "camera");
@@ -55,6 +133,70 @@ void Geometry::InitShaders()
 	uniformID[2] = glGetUniformLocation(shaderProgramID[0], "tex");
 	uniformID[3] = glGetUniformLocation(shaderProgramID[0], "light.position");
 	uniformID[4] = glGetUniformLocation(shaderProgramID[0], "light.rgb");
+
+	layerUniformID[0] = glGetUniformLocation(shaderProgramID[0], "layer");
+	layerUniformID[1] = glGetUniformLocation(shaderProgramID[1], "layer");
+
+	shadersReady = 1;
+	return 1;
+}
+
+void Geometry::DrawLoading()
+{
+	PROFILE_ZONE("Draw.Loading");
+
+	int ready = 0;
+	for (int i = 0; i < MAX_SHADERS; ++i)
+		ready += IsShaderProgramReady(shaderBuilds[i]);
+
+	glDisable(GL_DEPTH_TEST);
+	glUseProgram(loadingProgramID);
+	glBindVertexArray(loadingVAO);
+	glUniform1f(loadingProgressID, ready / (float)MAX_SHADERS);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glEnable(GL_DEPTH_TEST);
+
+	RenderMetrics::Add(RENDER_PROGRAM_BINDS);
+	RenderMetrics::Add(RENDER_VAO_BINDS);
+	RenderMetrics::Add(RENDER_UNIFORM_UPLOADS);
+	RenderMetrics::Add(RENDER_DRAW_CALLS);
+}
+
+///
+/// Textures, loaded when their screen is first drawn
+///
+
+// Layers of worldTextures. Images sharing an array must share a size.
+enum { LAYER_TUNNEL, LAYER_OBSTACLE };
+
+static const char *menuTexturePaths[] = { "res/mainMenu.jpg" };
+static const char *gameOverTexturePaths[] = { "res/gameOver.jpg" };
+static const char *worldTexturePaths[] = { "res/tunnel.bmp", "res/obstacle.bmp" };
+
+// Registers every set and starts decoding the menu's, the first
+// screen, while the window, GL context and shaders are set up
+void Geometry::QueueTextures()
+{
+	// Full screen images are drawn close to 1:1 and never tile
+	TextureSampler screenSampler;
+	screenSampler.wrapS = screenSampler.wrapT = GL_CLAMP_TO_EDGE;
+
+	// The tunnel is stretched 100x along Z and seen at grazing angles,
+	// obstacles shrink into the distance: both want anisotropy
+	TextureSampler worldSampler;
+	worldSampler.anisotropy = 16.f;
+
+	menuTextures = textures.Register(menuTexturePaths, 1, screenSampler);
+	gameOverTextures = textures.Register(gameOverTexturePaths, 1, screenSampler);
+	worldTextures = textures.Register(worldTexturePaths, 2, worldSampler);
+	lastGameState = -1;
+
+	textures.Prefetch(menuTextures);
+}
+
+void Geometry::SetTextureBudget(size_t bytes)
+{
+	textures.SetBudget(bytes);
 }
 
 ///
@@ -62,19 +204,16 @@ void Geometry::InitShaders()
 ///
 void Geometry::InitGeometry()
 {
-	// Generate random seed
-	srand(time_t(NULL));
+	STARTUP_PHASE("InitGeometry");
 
-	// Load textures
-	menuTexture = LoadTexture("res/mainMenu.jpg");
-	gameOverTexture = LoadTexture("res/gameOver.jpg");
-	tunnelTexture = LoadTexture("res/tunnel.bmp");
-	obstacleTexture = LoadTexture("res/obstacle.bmp");
+	// Upload the first screen's textures
+	textures.Acquire(menuTextures);
 
 	// Setup global light
 	globalLight.position = glm::vec3(0.f, 0.f, 0.f);
 	globalLight.rgb = glm::vec3(1.f, 255.f, 0.f);
 	brightness = 1;
+	lastPassed = 0;
 
 	//
 	// Element 0: 2d square on the floor
@@ -102,6 +241,7 @@ void Geometry::InitGeometry()
 	glGenBuffers(1, &VBO[0]);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	RenderMetrics::Add(RENDER_BUFFER_BYTES, sizeof(vertices));
 
 	// Link vertex attributes
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
@@ -111,11 +251,13 @@ void Geometry::InitGeometry()
 	glGenBuffers(1, &EBO[0]);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO[0]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW); 
+	RenderMetrics::Add(RENDER_BUFFER_BYTES, sizeof(indices));
 
-	// Set vertex attribute pointers
-	int vert = glGetAttribLocation(shaderProgramID[0], "vert");
-	int vertTexCoord = glGetAttribLocation(shaderProgramID[0], "vertTexCoord");
-	int vertNormal = glGetAttribLocation(shaderProgramID[0], "vertNormal");
+	// Set vertex attribute pointers. Locations are fixed in the
+	// shader, which may still be compiling.
+	int vert = ATTRIB_VERT;
+	int vertTexCoord = ATTRIB_TEXCOORD;
+	int vertNormal = ATTRIB_NORMAL;
 	
 	//                           index  size      type  normalize             stride                   offset pointer
 	glEnableVertexAttribArray(vert);
@@ -189,6 +331,7 @@ void Geometry::InitGeometry()
 	glGenBuffers(1, &VBO[1]);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesCube), verticesCube, GL_STATIC_DRAW);
+	RenderMetrics::Add(RENDER_BUFFER_BYTES, sizeof(verticesCube));
 	
 	// Set vertex attribute pointers
 	//                           index  size      type  normalize             stride                   offset pointer
@@ -246,6 +389,7 @@ void Geometry::InitGeometry()
 	glGenBuffers(1, &VBO[2]);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(verticesShip), verticesShip, GL_STATIC_DRAW);
+	RenderMetrics::Add(RENDER_BUFFER_BYTES, sizeof(verticesShip));
 
 	// Set vertex attribute pointers
 	//                           index  size      type  normalize             stride                   offset pointer
@@ -261,178 +405,279 @@ void Geometry::InitGeometry()
 }
 
 ///
-/// Loads fonts
+/// glText wrappers, keep the render metrics up to date
 ///
-void Geometry::InitFonts()
+static GLTtext* CreateText()
 {
-	gltInit();
-	ReadHighscore();
+	RenderMetrics::Add(RENDER_TEXT_OBJECTS);
+	return gltCreateText();
 }
 
+static void SetText(GLTtext *text, const char *str)
+{
+	// glText skips unchanged strings, so only count real uploads:
+	// 6 vertices of 4 floats per drawable character
+	const char *old = gltGetText(text);
+	if (!old || strcmp(old, str) != 0)
+		RenderMetrics::Add(RENDER_BUFFER_BYTES, gltCountDrawableCharacters(str) * 6 * 4 * sizeof(GLfloat));
+
+	gltSetText(text, str);
+}
+
+static void SetTextColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+	RenderMetrics::Add(RENDER_PROGRAM_BINDS);
+	RenderMetrics::Add(RENDER_UNIFORM_UPLOADS);
+	gltColor(r, g, b, a);
+}
 
-// Helper function
-void SetArray(bool *array, bool a, bool b, bool c, bool d, bool e, bool f)
+static void DrawText2D(GLTtext *text, GLfloat x, GLfloat y, GLfloat scale, int horizontalAlignment = GLT_LEFT)
+{
+	// Binds its own program, font texture and VAO (then unbinds it)
+	RenderMetrics::Add(RENDER_PROGRAM_BINDS);
+	RenderMetrics::Add(RENDER_TEXTURE_BINDS);
+	RenderMetrics::Add(RENDER_VAO_BINDS, 2);
+	RenderMetrics::Add(RENDER_UNIFORM_UPLOADS);
+	RenderMetrics::Add(RENDER_DRAW_CALLS);
+	gltDrawText2DAligned(text, x, y, scale, horizontalAlignment, GLT_TOP);
+}
+
+///
+/// Loads fonts
+///
+void Geometry::InitFonts()
 {
-	array[0] = a;
-	array[1] = b;
-	array[2] = c;
-	array[3] = d;
-	array[4] = e;
-	array[5] = f;
+	STARTUP_PHASE("InitFonts");
+
+	gltInit();
+	overlayText = CreateText();
+	highscoreText = CreateText();
+	scoreText = CreateText();
+	highscores.Load("highscores.bin", "highscores.txt");
+
+	// Sized for the longest score line up front, so the score
+	// counting up never grows glText's buffers during a game
+	gltSetText(scoreText, "Difficulty: Medium\nScore: 4294967295");
+	_gltUpdateBuffers(scoreText);
 }
 
 ///
-/// Generates random obstacles
+/// Tunnel faces and obstacles, with the lane angles and face width of
+/// a Sides sided tunnel known at compile time. Model matrices are
+/// written out from each lane's direction rather than composed.
 ///
-void Geometry::GenerateObstacles(unsigned int number, unsigned int offset)
+template <int Sides>
+void Geometry::DrawTunnel(float cosRotation, float sinRotation, const Simulation &simulation)
 {
-	int type, lastType;
+	typedef Tunnel<Sides> T;
+
+	TunnelLanes<Sides> lanes;
+	lanes.Rotate(cosRotation, sinRotation);
+
+	pipelineMatrix = projectionMatrix * viewMatrix;
 
-	for (unsigned int i = 0; i < number; ++i)
+	// Per lane, the face turned to point at the axis and stretched
+	// down the tunnel, and an obstacle the same way minus its depth.
+	// Turning by the lane's angle + 90 degrees is (-sin, cos).
+	glm::mat4 obstacleMatrix[Sides];
+	for (int i = 0; i < Sides; ++i)
 	{
-		lastType = type;
-		type = rand() % 11;
+		float c = lanes.cosine[i], s = lanes.sine[i];
+		obstacleMatrix[i] = glm::mat4(
+			glm::vec4(-s * T::tables.halfSide, c * T::tables.halfSide, 0.f, 0.f),
+			glm::vec4(-c * .7f, -s * .7f, 0.f, 0.f),
+			glm::vec4(0.f, 0.f, .3f, 0.f),
+			glm::vec4(c * OBSTACLE_APOTHEM, s * OBSTACLE_APOTHEM, 0.f, 1.f));
+	}
 
-		// Trick to make level seem slightly more random
-		if (type-3 == lastType || type == lastType || type+3 == lastType)
+	// Draw the tunnel
+	{
+		PROFILE_ZONE("Draw.Tunnel");
+		glUseProgram(shaderProgramID[0]);
+		glBindVertexArray(VAO[0]);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures.Acquire(worldTextures));
+		glUniform1i(layerUniformID[0], LAYER_TUNNEL);
+		RenderMetrics::Add(RENDER_PROGRAM_BINDS);
+		RenderMetrics::Add(RENDER_VAO_BINDS);
+		RenderMetrics::Add(RENDER_TEXTURE_BINDS);
+		RenderMetrics::Add(RENDER_UNIFORM_UPLOADS);
+
+		// Draw all faces individually
+		for (int i = 0; i < Sides; ++i)
 		{
-			type = (type + 1) % 11;
+			float c = lanes.cosine[i], s = lanes.sine[i];
+			modelMatrix = glm::mat4(
+				glm::vec4(-s * T::tables.halfSide, c * T::tables.halfSide, 0.f, 0.f),
+				glm::vec4(-c, -s, 0.f, 0.f),
+				glm::vec4(0.f, 0.f, 100.f, 0.f),
+				glm::vec4(c * TUNNEL_APOTHEM, s * TUNNEL_APOTHEM, 0.f, 1.f));
+
+			glUniformMatrix4fv(uniformID[0], 1, GL_FALSE, &pipelineMatrix[0][0]);
+			glUniformMatrix4fv(uniformID[1], 1, GL_FALSE, &modelMatrix[0][0]);
+			glUniform1i(uniformID[2], 0);
+			glUniform3fv(uniformID[3], 1, &globalLight.position[0]);
+			glUniform3fv(uniformID[4], 1, &globalLight.rgb[0]);
+			glDrawElements(GL_TRIANGLES, 6*6, GL_UNSIGNED_INT, 0);
+			RenderMetrics::Add(RENDER_UNIFORM_UPLOADS, 5);
+			RenderMetrics::Add(RENDER_DRAW_CALLS);
 		}
+	}
+
+	// Draw the obstacles
+	{
+		PROFILE_ZONE("Draw.Obstacles");
+		glUseProgram(shaderProgramID[0]);
+		glBindVertexArray(VAO[1]);
 
-		int distance;
+		// Same texture array as the tunnel, only the layer changes
+		glUniform1i(layerUniformID[0], LAYER_OBSTACLE);
+		RenderMetrics::Add(RENDER_PROGRAM_BINDS);
+		RenderMetrics::Add(RENDER_VAO_BINDS);
+		RenderMetrics::Add(RENDER_UNIFORM_UPLOADS);
 
-		switch (difficulty)
+		// Only the ones between the ship and the far plane
+		const ObstacleTrack &track = simulation.Track();
+		for (const Obstacle &o : track.Within(SIM_PASSED, FAR_PLANE * FIXED_ONE))
 		{
-			case 1:
-				distance = ( (i+offset) * 11) + 16;
-				break;
-			case 2:
-				distance = ( (i+offset) * 16) + 40;
-				break;
-			case 3:
-				distance = ( (i+offset) * 28) + 58;
-				break;
-		}
+			float z = -FixedToFloat(track.Distance(o));
 
-		bool obstacleArray[6];
+			for (int i = 0; i < Sides; ++i)
+			{
+				if (T::Blocks(o.blocked, i))
+				{
+					modelMatrix = obstacleMatrix[i];
+					modelMatrix[3][2] = z;
 
-		switch (type)
-		{
-			case 0:
-				SetArray(&obstacleArray[0], 1,1,1,1,1,0);
-				break;
-			case 1:
-				SetArray(&obstacleArray[0], 1,1,1,1,0,1);
-				break;
-			case 2:
-				SetArray(&obstacleArray[0], 1,1,1,0,1,1);
-				break;
-			case 3:
-				SetArray(&obstacleArray[0], 1,1,0,1,1,1);
-				break;
-			case 4:
-				SetArray(&obstacleArray[0], 1,0,1,1,1,1);
-				break;
-			case 5:
-				SetArray(&obstacleArray[0], 0,1,1,1,1,1);
-				break;
-			case 6:
-				SetArray(&obstacleArray[0], 1,0,1,0,1,0);
-				break;
-			case 7:
-				SetArray(&obstacleArray[0], 0,1,0,1,0,1);
-				break;
-			case 8:
-				SetArray(&obstacleArray[0], 1,0,1,1,1,0);
-				break;
-			case 9:
-				SetArray(&obstacleArray[0], 0,1,1,1,0,1);
-				break;
-			case 10:
-				SetArray(&obstacleArray[0], 1,1,1,0,1,0);
-				break;
+					glUniformMatrix4fv(uniformID[0], 1, GL_FALSE, &pipelineMatrix[0][0]);
+					glUniformMatrix4fv(uniformID[1], 1, GL_FALSE, &modelMatrix[0][0]);
+					glUniform1i(uniformID[2], 0);
+					glUniform3fv(uniformID[3], 1, &globalLight.position[0]);
+					glUniform3fv(uniformID[4], 1, &globalLight.rgb[0]);
+					glDrawArrays(GL_TRIANGLES, 0, 6*6);
+					RenderMetrics::Add(RENDER_UNIFORM_UPLOADS, 5);
+					RenderMetrics::Add(RENDER_DRAW_CALLS);
+				}
+			}
 		}
-
-		Obstacle* obstacle = new Obstacle(obstacleArray, distance);
-		obstacles.push_back(obstacle);
 	}
 }
 
 ///
 /// Called every frame
 ///
-int Geometry::Draw(Uint32 elapsedTime, unsigned short int gameState)
+void Geometry::Draw(Uint32 elapsedTime, unsigned short int gameState, const Simulation &simulation)
 {
+	// Decode whatever the screen after this one needs
+	if (gameState != lastGameState)
+	{
+		if (gameState == 0)
+			textures.Prefetch(worldTextures);
+		else if (gameState == 3)
+			textures.Prefetch(gameOverTextures);
+		else if (gameState == 1)
+			textures.Prefetch(menuTextures);
+
+		lastGameState = gameState;
+	}
+
+	// Streams a little of it in each frame
+	textures.Update();
+
 	// Draw main menu
 	if (gameState == 0)
 	{
+		PROFILE_ZONE("Draw.Menu");
+
 		// Ignore lighting
 		glUseProgram(shaderProgramID[1]);
 
 		// Use 2d square VAO to draw menu texture
 		glBindVertexArray(VAO[0]);
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, menuTexture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures.Acquire(menuTextures));
+		RenderMetrics::Add(RENDER_PROGRAM_BINDS);
+		RenderMetrics::Add(RENDER_VAO_BINDS);
+		RenderMetrics::Add(RENDER_TEXTURE_BINDS);
 
-		modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.85f));
-		modelMatrix = glm::scale(modelMatrix, glm::vec3(9.f, 9.f, 1.f));
-		modelMatrix = glm::rotate(modelMatrix, -90 * ((float)PI/180), glm::vec3(1.f, 0.f, 0.f));
+		modelMatrix = screenMatrix;
 		pipelineMatrix = projectionMatrix * viewMatrix;
 
 		glUniformMatrix4fv(uniformID[0], 1, GL_FALSE, &pipelineMatrix[0][0]);
 		glUniformMatrix4fv(uniformID[1], 1, GL_FALSE, &modelMatrix[0][0]);
 		glUniform1i(uniformID[2], 0);
+		glUniform1i(layerUniformID[1], 0);
 		glUniform3fv(uniformID[3], 1, &globalLight.position[0]);
 		glUniform3fv(uniformID[4], 1, &globalLight.rgb[0]);
 		glDrawElements(GL_TRIANGLES, 6*6, GL_UNSIGNED_INT, 0);
-
-		// beautiful work of art, please do not judge
-		std::stringstream highscoreText;
-		for (int i = 0; i < 5; ++i)
+		RenderMetrics::Add(RENDER_UNIFORM_UPLOADS, 6);
+		RenderMetrics::Add(RENDER_DRAW_CALLS);
+
+		// Only re-uploaded by glText when the tables change
+		char text[512];
+		int length = 0;
+		unsigned int shown = highscores.Depth() < HIGHSCORES_SHOWN ? highscores.Depth() : HIGHSCORES_SHOWN;
+		for (unsigned short int d = 1; d <= HIGHSCORE_DIFFICULTIES; ++d)
 		{
-			highscoreText << "Highscore #" << i+1 << ": " << highscores[i] << '\n';
+			length += snprintf(text + length, sizeof(text) - length, "%sDifficulty %u\n", d > 1 ? "\n" : "", d);
+			for (unsigned int i = 0; i < shown; ++i)
+				length += snprintf(text + length, sizeof(text) - length, "Highscore #%u: %u\n", i+1, highscores.Scores(d)[i]);
 		}
-		GLTtext *text = gltCreateText();
-		gltSetText(text, highscoreText.str().c_str());
-		gltColor(1.0f, 1.0f, 1.0f, 1.0f);
-		gltDrawText2D(text, 0, 0, 1);
+		SetText(highscoreText, text);
+		SetTextColor(1.0f, 1.0f, 1.0f, 1.0f);
+		DrawText2D(highscoreText, 0, 0, 1);
 	}
 
 	// Draw the game over screen
 	else if (gameState == 1)
 	{
+		PROFILE_ZONE("Draw.GameOver");
+
 		// Ignore lighting
 		glUseProgram(shaderProgramID[1]);
 
 		// Use 2d square VAO to draw menu texture
 		glBindVertexArray(VAO[0]);
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, gameOverTexture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures.Acquire(gameOverTextures));
+		RenderMetrics::Add(RENDER_PROGRAM_BINDS);
+		RenderMetrics::Add(RENDER_VAO_BINDS);
+		RenderMetrics::Add(RENDER_TEXTURE_BINDS);
 
-		modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.85f));
-		modelMatrix = glm::scale(modelMatrix, glm::vec3(9.f, 9.f, 1.f));
-		modelMatrix = glm::rotate(modelMatrix, -90 * ((float)PI/180), glm::vec3(1.f, 0.f, 0.f));
+		modelMatrix = screenMatrix;
 		pipelineMatrix = projectionMatrix * viewMatrix;
 
 		glUniformMatrix4fv(uniformID[0], 1, GL_FALSE, &pipelineMatrix[0][0]);
 		glUniformMatrix4fv(uniformID[1], 1, GL_FALSE, &modelMatrix[0][0]);
 		glUniform1i(uniformID[2], 0);
+		glUniform1i(layerUniformID[1], 0);
 		glUniform3fv(uniformID[3], 1, &globalLight.position[0]);
 		glUniform3fv(uniformID[4], 1, &globalLight.rgb[0]);
 		glDrawElements(GL_TRIANGLES, 6*6, GL_UNSIGNED_INT, 0);
+		RenderMetrics::Add(RENDER_UNIFORM_UPLOADS, 6);
+		RenderMetrics::Add(RENDER_DRAW_CALLS);
 	}
 
 	// Draw the game itself
 	else if (gameState == 3)
 	{
-		// Update color
-		hue = (hue + (elapsedTime*0.1) );
+		// Update color, 6 steps a second
+		hue = (hue + (elapsedTime*0.006) );
 
 		if (hue > 255)
 			hue = 0;
 
 		if (brightness > 1)
-			brightness -= elapsedTime * 0.04;
+			brightness -= elapsedTime * 0.0024;
+
+		// Blinking light effect whenever an obstacle went past
+		if (simulation.Passed() != lastPassed)
+		{
+			brightness = 10;
+			lastPassed = simulation.Passed();
+		}
+
+		double tunnelRotation = FixedToFloat(simulation.Rotation());
 
 		HsvColor hsv;
 		hsv.h = hue;
@@ -442,30 +687,43 @@ int Geometry::Draw(Uint32 elapsedTime, unsigned short int gameState)
 		RgbColor rgb;
 		rgb = HsvToRgb(hsv);
 
-		// Place light in tunnel
+		// The only trig of the frame: lanes get their angles from
+		// these by angle addition
 		float dx = cos ( tunnelRotation * (PI/180) );
 		float dy = sin ( tunnelRotation * (PI/180) );
+
+		// Place light in tunnel
 		globalLight.position = glm::vec3(dx, dy, 3.f);
 		globalLight.rgb = glm::vec3(brightness * rgb.r / (float)255, brightness * rgb.g / (float)255, brightness * rgb.b / (float)255);
 
-		// Draw the tunnel
-		glUseProgram(shaderProgramID[0]);
-		glBindVertexArray(VAO[0]);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, tunnelTexture);
+		// Draw the tunnel and obstacles, compiled per mode
+		switch (simulation.Sides())
+		{
+			case 4:
+				DrawTunnel<4>(dx, dy, simulation);
+				break;
+			case 8:
+				DrawTunnel<8>(dx, dy, simulation);
+				break;
+			default:
+				DrawTunnel<6>(dx, dy, simulation);
+				break;
+		}
 
-		// Draw all 6 faces individually
-		for (int i = 0; i < 6; ++i)
+		// Draw the spaceship
 		{
-			float j = (i * 60) + 30 - tunnelRotation;
+			PROFILE_ZONE("Draw.Ship");
+			globalLight.position = glm::vec3(dx, dy, 5.f);
+			globalLight.rgb = glm::vec3(1.3 * brightness * rgb.r / (float)255, brightness * rgb.g / (float)255, brightness * rgb.b / (float)255);
 
-			float dx = 1.73 * cos( j * (PI/180) );
-			float dy = 1.73 * sin( j * (PI/180) );
+			glUseProgram(shaderProgramID[0]);
+			glBindVertexArray(VAO[2]);
 
-			modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(dx, dy, 0.0f));
-			modelMatrix = glm::scale(modelMatrix, glm::vec3(1.f, 1.f, 100.f));
-			modelMatrix = glm::rotate(modelMatrix, (j + 90) * ((float)PI/180), glm::vec3(0.f, 0.f, 1.f));
+			// Still bound to the obstacle layer
+			RenderMetrics::Add(RENDER_PROGRAM_BINDS);
+			RenderMetrics::Add(RENDER_VAO_BINDS);
 
+			modelMatrix = shipMatrix;
 			pipelineMatrix = projectionMatrix * viewMatrix;
 
 			glUniformMatrix4fv(uniformID[0], 1, GL_FALSE, &pipelineMatrix[0][0]);
@@ -473,239 +731,82 @@ int Geometry::Draw(Uint32 elapsedTime, unsigned short int gameState)
 			glUniform1i(uniformID[2], 0);
 			glUniform3fv(uniformID[3], 1, &globalLight.position[0]);
 			glUniform3fv(uniformID[4], 1, &globalLight.rgb[0]);
-			glDrawElements(GL_TRIANGLES, 6*6, GL_UNSIGNED_INT, 0);
+			glDrawArrays(GL_TRIANGLES, 0, 18);
+			RenderMetrics::Add(RENDER_UNIFORM_UPLOADS, 5);
+			RenderMetrics::Add(RENDER_DRAW_CALLS);
 		}
 
-		// Draw the obstacles
-		glUseProgram(shaderProgramID[0]);
-		glBindVertexArray(VAO[1]);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, obstacleTexture);
-
-		for (auto it = obstacles.begin(); it != obstacles.end(); ++it)
+		// beautiful work of art, please do not judge
 		{
-			Obstacle *o = *it;
-			o->Update(elapsedTime * 0.05 * (difficulty * 0.6) );
-
-			// Obstacle is past camera. Generate new obstacles,
-			// do blinking light effect and delete obstacle
-			if (o->distance < -5.5)
+			PROFILE_ZONE("Draw.Text");
+			const char *difficultyName = "";
+			switch (simulation.Difficulty())
 			{
-				GenerateObstacles(1, 49);
-				brightness = 10;
-				score += 100 * movementSpeed;
-
-				obstacles.erase(it);
-				delete o;
-				continue;
+				case 1:
+					difficultyName = "Easy";
+					break;
+				case 2:
+					difficultyName = "Medium";
+					break;
+				case 3:
+					difficultyName = "Hard";
+					break;
 			}
 
-			for (int i = 0; i < 6; ++i)
-			{
-				if (o->side[i])
-				{
-					// Collision detection
-					if (o->distance < -4.5)
-					{
-						int pos = ((((int)tunnelRotation + 30) / 60) - 0) % 6;
-						if ( pos == i )
-						{
-							std::cout << "\nAngle: " << tunnelRotation;
-							std::cout << "\nWall Pos: " << i;
-							std::cout << "\nCalculated Pos: " << pos;
-							std::cout << '\n';
-
-							SaveHighscore(score);
-							ReadHighscore();
-
-							return 1;
-						}
-					}
-
-					// Drawing
-					float j = (i * 60) + 30 + (-tunnelRotation) - (60*2);
-
-					float dx = 1.70 * cos( j * (PI/180) );
-					float dy = 1.70 * sin( j * (PI/180) );
-
-					modelMatrix = glm::mat4(1.0f);
-					modelMatrix = glm::translate(modelMatrix, glm::vec3(dx, dy, (o->distance) * -1.0) );
-					modelMatrix = glm::rotate(modelMatrix, (j + 90) * ((float)PI/180), glm::vec3(0.f, 0.f, 1.f));
-					modelMatrix = glm::scale(modelMatrix, glm::vec3(1.f, .7f, .3f));
-					pipelineMatrix = projectionMatrix * viewMatrix;
-
-					glUniformMatrix4fv(uniformID[0], 1, GL_FALSE, &pipelineMatrix[0][0]);
-					glUniformMatrix4fv(uniformID[1], 1, GL_FALSE, &modelMatrix[0][0]);
-					glUniform1i(uniformID[2], 0);
-					glUniform3fv(uniformID[3], 1, &globalLight.position[0]);
-					glUniform3fv(uniformID[4], 1, &globalLight.rgb[0]);
-					glDrawArrays(GL_TRIANGLES, 0, 6*6);
-				}
-			}
+			// Only re-uploaded by glText when the score changes
+			char text[64];
+			snprintf(text, sizeof(text), "Difficulty: %s\nScore: %u", difficultyName, simulation.Score());
+			SetText(scoreText, text);
+			SetTextColor(1.0f, 1.0f, 1.0f, 1.0f);
+			DrawText2D(scoreText, 0, 0, 1);
 		}
-
-		// Draw the spaceship
-		globalLight.position = glm::vec3(dx, dy, 5.f);
-		globalLight.rgb = glm::vec3(1.3 * brightness * rgb.r / (float)255, brightness * rgb.g / (float)255, brightness * rgb.b / (float)255);
-
-		glUseProgram(shaderProgramID[0]);
-		glBindVertexArray(VAO[2]);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, obstacleTexture);
-
-		modelMatrix = glm::mat4(1.0f);
-		modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, -1.5f, 4.f));
-		modelMatrix = glm::scale(modelMatrix, glm::vec3(0.1f, 0.1f, 0.1f));
-		//modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, -1.7f, 4.85f));
-		//modelMatrix = glm::scale(modelMatrix, glm::vec3(0.02f, 0.02f, 0.02f));
-		modelMatrix = glm::rotate(modelMatrix, -90 * ((float)PI/180), glm::vec3(1.f, 0.f, 0.f));
-		modelMatrix = glm::rotate(modelMatrix, 45 * ((float)PI/180), glm::vec3(0.f, 1.f, 0.f));
-		pipelineMatrix = projectionMatrix * viewMatrix;
-
-		glUniformMatrix4fv(uniformID[0], 1, GL_FALSE, &pipelineMatrix[0][0]);
-		glUniformMatrix4fv(uniformID[1], 1, GL_FALSE, &modelMatrix[0][0]);
-		glUniform1i(uniformID[2], 0);
-		glUniform3fv(uniformID[3], 1, &globalLight.position[0]);
-		glUniform3fv(uniformID[4], 1, &globalLight.rgb[0]);
-		glDrawArrays(GL_TRIANGLES, 0, 18);
-
-		// beautiful work of art, please do not judge
-		std::stringstream scoreText;
-		switch (difficulty)
-		{
-			case 1:
-				scoreText << "Difficulty: Easy";
-				break;
-			case 2:
-				scoreText << "Difficulty: Medium";
-				break;
-			case 3:
-				scoreText << "Difficulty: Hard";
-				break;
-		}
-		scoreText << "\nScore: " << score;
-		GLTtext *text = gltCreateText();
-		gltSetText(text, scoreText.str().c_str());
-		gltColor(1.0f, 1.0f, 1.0f, 1.0f);
-		gltDrawText2D(text, 0, 0, 1);
 	}
-
-	return 0;
-}
-
-double Geometry::GetRotation()
-{
-	return tunnelRotation;
 }
 
 ///
-/// Called every time the game starts
+/// Render metrics of the previous frame, top right corner
 ///
-void Geometry::SetDifficulty(unsigned short int d)
+void Geometry::DrawOverlay()
 {
-	difficulty = d;
-	score = 0;
+	PROFILE_ZONE("Draw.Overlay");
 
-	switch (d)
+	const unsigned long *counters = RenderMetrics::LastFrame();
+
+	char overlay[512];
+	int length = 0;
+	for (int c = 0; c < RENDER_COUNTER_COUNT; ++c)
 	{
-		case 1:
-			movementSpeed = 1;
-			break;
-		case 2:
-			movementSpeed = 1.3;
-			break;
-		case 3:
-			movementSpeed = 1.6;
-			break;
+		length += snprintf(overlay + length, sizeof(overlay) - length, "%s: %lu\n",
+			RenderMetrics::Name((RenderCounter)c), counters[c]);
 	}
+	snprintf(overlay + length, sizeof(overlay) - length, "Resident textures: %.1f MB\n",
+		textures.ResidentBytes() / 1048576.0);
 
-	Cleanup();
-	GenerateObstacles(50, 0);
-}
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
 
-///
-/// Called every time the game ends
-///
-void Geometry::Cleanup()
-{
-	obstacles.clear();
+	SetText(overlayText, overlay);
+	SetTextColor(1.0f, 1.0f, 0.0f, 1.0f);
+	DrawText2D(overlayText, viewport[2], 0, 1, GLT_RIGHT);
 }
 
 ///
 /// Score
 ///
-void Geometry::ReadHighscore()
+void Geometry::SetHighscoreDepth(unsigned int entries)
 {
-	// Read all highscores
-	std::ifstream ifFile;
-	ifFile.open("highscores.txt");
-	std::string line;
-
-	getline(ifFile, line);
-	highscores[0] = std::stoi(line);
-	getline(ifFile, line);
-	highscores[1] = std::stoi(line);
-	getline(ifFile, line);
-	highscores[2] = std::stoi(line);
-	getline(ifFile, line);
-	highscores[3] = std::stoi(line);
-	getline(ifFile, line);
-	highscores[4] = std::stoi(line);
-
-	ifFile.close();
+	highscores.SetDepth(entries);
 }
 
-void Geometry::SaveHighscore(unsigned int s)
+// Written out on the store's own thread
+void Geometry::SubmitScore(unsigned short int difficulty, unsigned int score)
 {
-	std::cout << "LOG: Saving " << s << '\n';
-
-	ReadHighscore();
-
-	// Save highscore
-	std::ofstream ofFile;
-	ofFile.open("highscores.txt", std::ofstream::out | std::ofstream::trunc);
-
-	int biggerThan = -1;
-	int displace = 0;
-
-	if (s > highscores[0])
-		biggerThan = 0;
-	else if (s > highscores[1])
-		biggerThan = 1;
-	else if (s > highscores[2])
-		biggerThan = 2;
-	else if (s > highscores[3])
-		biggerThan = 3;
-	else if (s > highscores[4])
-		biggerThan = 4;
-
-	for (int i = 0; i < 5; ++i)
-	{
-		if (biggerThan == i)
-		{
-			ofFile << s;
-			displace = 1;
-		}
-		else
-			ofFile << highscores[i-displace];
-
-		ofFile << '\n';
-	}
-
-	ofFile.close();
+	if (highscores.Submit(difficulty, score) >= 0)
+		LOG_INFO("New highscore %u on difficulty %u", score, difficulty);
 }
 
-///
-/// Player movement
-///
-void Geometry::Rotate(Uint32 elapsedTime, int dir)
+// Waits for the store's thread, which logs, to write the last scores
+void Geometry::SaveHighscores()
 {
-	// Move
-	tunnelRotation += ((elapsedTime * 0.5f) * dir) * movementSpeed;
-	
-	if (tunnelRotation > 360)
-		tunnelRotation -= 360;
-
-	if (tunnelRotation < 0)
-		tunnelRotation += 360;
+	highscores.Stop();
 }
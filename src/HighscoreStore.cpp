@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <functional>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h> // fsync
+
+#include <HighscoreStore.h>
+#include <StartupProfile.h>
+#include <Profiler.h>
+#include <Logger.h>
+
+static_assert(sizeof(HighscoreFileHeader) == 16, "HighscoreFileHeader must not be padded");
+
+// FNV-1a
+static uint32_t Checksum(const uint32_t* scores, size_t count)
+{
+	const unsigned char* data = (const unsigned char*)scores;
+	uint32_t hash = 0x811c9dc5u;
+	for (size_t i = 0; i < count * sizeof(uint32_t); ++i)
+	{
+		hash ^= data[i];
+		hash *= 0x01000193u;
+	}
+	return hash;
+}
+
+HighscoreStore::HighscoreStore()
+{
+	depth = HIGHSCORE_DEFAULT_DEPTH;
+	dirty = false;
+	stopping = false;
+}
+
+HighscoreStore::~HighscoreStore()
+{
+	Stop();
+}
+
+void HighscoreStore::SetDepth(unsigned int entries)
+{
+	depth = entries ? entries : 1;
+}
+
+///
+/// Loading
+///
+
+// Whole file in one read, then checked before anything is used
+bool HighscoreStore::Read(const char* file)
+{
+	FILE* in = fopen(file, "rb");
+	if (!in)
+		return 0;
+
+	std::vector<unsigned char> data;
+	if (fseek(in, 0, SEEK_END) == 0)
+	{
+		long size = ftell(in);
+		if (size > 0)
+		{
+			data.resize(size);
+			rewind(in);
+			if (fread(&data[0], size, 1, in) != 1)
+				data.clear();
+		}
+	}
+	fclose(in);
+
+	HighscoreFileHeader header;
+	if (data.size() < sizeof(header))
+		return 0;
+	memcpy(&header, &data[0], sizeof(header));
+
+	if (header.magic != HIGHSCORE_MAGIC || header.version != HIGHSCORE_VERSION || !header.depth
+		|| data.size() != sizeof(header) + (size_t)header.tables * header.depth * sizeof(uint32_t))
+		return 0;
+
+	std::vector<uint32_t> stored((size_t)header.tables * header.depth);
+	if (!stored.empty())
+		memcpy(&stored[0], &data[sizeof(header)], stored.size() * sizeof(uint32_t));
+
+	if (Checksum(stored.data(), stored.size()) != header.checksum)
+		return 0;
+
+	// Tables deeper than ours lose their tail, shallower ones stay padded with 0
+	unsigned int tables = std::min<unsigned int>(header.tables, HIGHSCORE_DIFFICULTIES);
+	unsigned int entries = std::min<unsigned int>(header.depth, depth);
+	for (unsigned int t = 0; t < tables; ++t)
+		std::copy(&stored[t * header.depth], &stored[t * header.depth] + entries, &scores[t * depth]);
+
+	return 1;
+}
+
+// The single list from before there were difficulties
+void HighscoreStore::ImportText(const char* file)
+{
+	FILE* in = fopen(file, "r");
+	if (!in)
+		return;
+
+	std::vector<uint32_t> list;
+	unsigned int score;
+	while (list.size() < depth && fscanf(in, "%u", &score) == 1)
+		list.push_back(score);
+	fclose(in);
+
+	std::sort(list.begin(), list.end(), std::greater<uint32_t>());
+	for (unsigned int t = 0; t < HIGHSCORE_DIFFICULTIES; ++t)
+		std::copy(list.begin(), list.end(), &scores[t * depth]);
+
+	LOG_INFO("Imported %u highscores from %s", (unsigned int)list.size(), file);
+}
+
+void HighscoreStore::Load(const char* file, const char* legacyPath)
+{
+	STARTUP_PHASE("ReadHighscore");
+
+	path = file;
+	scores.assign((size_t)HIGHSCORE_DIFFICULTIES * depth, 0);
+	pending.assign(scores.size(), 0);
+
+	if (!Read(file))
+	{
+		FILE* exists = fopen(file, "rb");
+		if (exists)
+		{
+			fclose(exists);
+			LOG_ERROR("%s is damaged or from another version, starting with empty highscores", file);
+		}
+		else if (legacyPath)
+		{
+			// Saved in the new format on the first new highscore
+			ImportText(legacyPath);
+		}
+	}
+
+	if (!writer.joinable())
+	{
+		stopping = false;
+		writer = std::thread(&HighscoreStore::WriterLoop, this);
+	}
+}
+
+///
+/// Updating
+///
+const uint32_t* HighscoreStore::Scores(unsigned short int difficulty) const
+{
+	if (difficulty < 1 || difficulty > HIGHSCORE_DIFFICULTIES)
+		difficulty = 1;
+
+	return &scores[(difficulty - 1) * depth];
+}
+
+int HighscoreStore::Submit(unsigned short int difficulty, unsigned int score)
+{
+	if (difficulty < 1 || difficulty > HIGHSCORE_DIFFICULTIES || scores.empty())
+		return -1;
+
+	// After every entry at least as good, so ties keep their order
+	uint32_t* table = &scores[(difficulty - 1) * depth];
+	uint32_t* slot = std::upper_bound(table, table + depth, (uint32_t)score, std::greater<uint32_t>());
+	if (slot == table + depth)
+		return -1;
+
+	std::copy_backward(slot, table + depth - 1, table + depth);
+	*slot = score;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::copy(scores.begin(), scores.end(), pending.begin());
+		dirty = true;
+	}
+	wake.notify_one();
+
+	return slot - table;
+}
+
+void HighscoreStore::Stop()
+{
+	if (!writer.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+}
+
+///
+/// Writer thread
+///
+void HighscoreStore::WriterLoop()
+{
+	Profiler::SetThreadName("HighscoreWriter");
+
+	std::vector<uint32_t> tables;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		wake.wait(lock, [this]() { return dirty || stopping; });
+		if (!dirty)
+			return;
+
+		// Tables submitted while these are written replace them
+		tables = pending;
+		dirty = false;
+		lock.unlock();
+
+		{
+			PROFILE_ZONE("SaveHighscore");
+
+			HighscoreFileHeader header;
+			header.magic = HIGHSCORE_MAGIC;
+			header.version = HIGHSCORE_VERSION;
+			header.tables = HIGHSCORE_DIFFICULTIES;
+			header.depth = depth;
+			header.checksum = Checksum(tables.data(), tables.size());
+
+			std::string temporary = path + ".tmp";
+			FILE* out = fopen(temporary.c_str(), "wb");
+
+			bool written = out != nullptr
+				&& fwrite(&header, sizeof(header), 1, out) == 1
+				&& fwrite(tables.data(), tables.size() * sizeof(uint32_t), 1, out) == 1;
+
+			// On disk before the rename makes it the table
+			if (out)
+			{
+				written = fflush(out) == 0 && fsync(fileno(out)) == 0 && written;
+				written = fclose(out) == 0 && written;
+			}
+
+			if (written && rename(temporary.c_str(), path.c_str()) == 0)
+				LOG_DEBUG("Highscores saved to %s", path.c_str());
+			else
+			{
+				remove(temporary.c_str());
+				LOG_ERROR("Failed to save highscores to %s", path.c_str());
+			}
+		}
+
+		lock.lock();
+	}
+}
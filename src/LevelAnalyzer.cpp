@@ -0,0 +1,217 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+#include <LevelAnalyzer.h>
+#include <Solvability.h>
+#include <Simulation.h>
+#include <Profiler.h>
+#include <Logger.h>
+
+// Sequences a worker claims at a time
+#define ANALYZER_CHUNK 4096
+
+// Obstacles per sequence unless told otherwise
+#define ANALYZER_LENGTH 50
+
+LevelAnalysisOptions::LevelAnalysisOptions()
+{
+	sequences = 10000000;
+	length = ANALYZER_LENGTH;
+	threads = 0;
+	difficulty = 0;
+	sides = TUNNEL_DEFAULT_SIDES;
+	seed = 1;
+}
+
+struct AnalyzerCounts
+{
+	uint64_t impossible[3];
+
+	// Obstacles into the sequence the first dead end was, summed
+	uint64_t failedAt[3];
+
+	AnalyzerCounts()
+	{
+		for (int d = 0; d < 3; ++d)
+			impossible[d] = failedAt[d] = 0;
+	}
+};
+
+
+template <int Sides>
+static void Analyze(const LevelAnalysisOptions &options, std::atomic<uint64_t> &next, AnalyzerCounts &counts)
+{
+	typedef Tunnel<Sides> T;
+
+	Profiler::SetThreadName("LevelAnalyzer");
+
+	const Solvability<Sides> &solvability = Solvability<Sides>::Tables();
+
+	LaneMask open[T::Types()];
+	for (int t = 0; t < T::Types(); ++t)
+		open[t] = T::Open(t);
+
+	// Counted here and handed back once, so the workers' counts, which
+	// sit next to each other, don't keep sharing cache lines
+	AnalyzerCounts local;
+
+	for (;;)
+	{
+		uint64_t begin = next.fetch_add(ANALYZER_CHUNK, std::memory_order_relaxed);
+		if (begin >= options.sequences)
+		{
+			counts = local;
+			return;
+		}
+
+		uint64_t end = begin + ANALYZER_CHUNK;
+		if (end > options.sequences)
+			end = options.sequences;
+
+		for (uint64_t i = begin; i < end; ++i)
+		{
+			unsigned short int d = options.difficulty ? options.difficulty : 1 + i % 3;
+
+			// Same random numbers and type choice as the generator
+			uint32_t random = Simulation::MixSeed(options.seed, i);
+			int type = -1;
+			LaneMask lanes = solvability.Start(d);
+			for (unsigned int n = 0; n < options.length; ++n)
+			{
+				type = Simulation::ChooseType(Simulation::NextRandom(random), type, T::Types());
+
+				lanes = solvability.Next(d, lanes, open[type]);
+				if (!lanes)
+				{
+					++local.impossible[d - 1];
+					local.failedAt[d - 1] += n;
+					break;
+				}
+			}
+		}
+	}
+}
+
+template <int Sides>
+static void ReportTables(unsigned short int d)
+{
+	typedef Tunnel<Sides> T;
+
+	const Solvability<Sides> &solvability = Solvability<Sides>::Tables();
+
+	// Slowest of each move, whichever lane it starts from
+	uint32_t moves[Sides / 2 + 1] = {};
+	for (int a = 0; a < Sides; ++a)
+	{
+		for (int k = 1; k <= Sides / 2; ++k)
+		{
+			uint32_t ticks = solvability.LaneTicks(d, a, (a + k) % Sides);
+			if (ticks > moves[k])
+				moves[k] = ticks;
+		}
+	}
+
+	printf("  %u ticks between obstacles, moving 1 to %d lanes takes", solvability.MoveTicks(d), Sides / 2);
+	for (int k = 1; k <= Sides / 2; ++k)
+		printf("%s%u", k > 1 ? "/" : " ", moves[k]);
+	printf(" ticks\n");
+
+	// Pairs of obstacle types the player can't get through
+	unsigned int pairs = 0;
+	for (int a = 0; a < T::Types(); ++a)
+	{
+		for (int b = 0; b < T::Types(); ++b)
+		{
+			if (!solvability.Next(d, T::Open(a), T::Open(b)))
+			{
+				if (!pairs++)
+					printf("  impossible type pairs:");
+				printf(" %d-%d", a, b);
+			}
+		}
+	}
+	if (pairs)
+		printf("\n");
+}
+
+bool LevelAnalyzer::Run(const LevelAnalysisOptions &options)
+{
+	PROFILE_ZONE("LevelAnalyzer");
+
+	unsigned int threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+	if (!threads)
+		threads = 1;
+
+	LOG_INFO("Analyzing %llu obstacle sequences of %u on %u threads, %u sided tunnel",
+		(unsigned long long)options.sequences, options.length, threads, options.sides);
+
+	// Built before the clock starts
+	void (*analyze)(const LevelAnalysisOptions&, std::atomic<uint64_t>&, AnalyzerCounts&);
+	void (*report)(unsigned short int);
+	switch (options.sides)
+	{
+		case 4:
+			Solvability<4>::Tables();
+			analyze = Analyze<4>;
+			report = ReportTables<4>;
+			break;
+		case 8:
+			Solvability<8>::Tables();
+			analyze = Analyze<8>;
+			report = ReportTables<8>;
+			break;
+		default:
+			Solvability<6>::Tables();
+			analyze = Analyze<6>;
+			report = ReportTables<6>;
+			break;
+	}
+
+	std::vector<AnalyzerCounts> counts(threads);
+	std::atomic<uint64_t> next(0);
+
+	uint64_t start = Profiler::Now();
+	{
+		std::vector<std::thread> workers;
+		for (unsigned int t = 0; t < threads; ++t)
+			workers.push_back(std::thread(analyze, std::cref(options), std::ref(next), std::ref(counts[t])));
+		for (std::thread &worker : workers)
+			worker.join();
+	}
+	double seconds = (Profiler::Now() - start) / 1e9;
+
+	printf("%llu sequences of %u obstacles, %u threads: %.3f s, %.2f M sequences/s\n",
+		(unsigned long long)options.sequences, options.length, threads, seconds,
+		seconds > 0 ? options.sequences / seconds / 1e6 : 0.0);
+
+	for (unsigned short int d = 1; d <= 3; ++d)
+	{
+		if (options.difficulty && options.difficulty != d)
+			continue;
+
+		// Sequence i is played at difficulty 1 + i % 3 when cycling
+		uint64_t sequences = options.sequences;
+		if (!options.difficulty)
+			sequences = options.sequences / 3 + (options.sequences % 3 > (uint64_t)(d - 1) ? 1 : 0);
+
+		uint64_t impossible = 0, failedAt = 0;
+		for (const AnalyzerCounts &c : counts)
+		{
+			impossible += c.impossible[d - 1];
+			failedAt += c.failedAt[d - 1];
+		}
+
+		printf("Difficulty %u: %llu of %llu impossible (%.4f%%)", d, (unsigned long long)impossible,
+			(unsigned long long)sequences, sequences ? 100.0 * impossible / sequences : 0.0);
+		if (impossible)
+			printf(", first dead end at obstacle %.1f on average", (double)failedAt / impossible);
+		printf("\n");
+
+		report(d);
+	}
+
+	fflush(stdout);
+	return 1;
+}
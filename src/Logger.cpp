@@ -0,0 +1,207 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <Logger.h>
+#include <Profiler.h>
+
+// How long the writer sleeps when the queue is empty
+#define LOG_IDLE_MS 2
+
+///
+/// Bounded multi-producer queue (Dmitry Vyukov's design). Each slot's
+/// sequence number says whether it is free for the producer that
+/// claims position 'pos' (seq == pos) or holds a message (seq == pos + 1).
+///
+struct LogSlot
+{
+	// Stored minus the slot index, so the zero-initialized
+	// queue is already valid before Start() is called
+	std::atomic<size_t> sequence;
+	int level;
+	char text[LOG_MESSAGE_SIZE];
+};
+
+static LogSlot queue[LOG_QUEUE_SIZE];
+static std::atomic<size_t> enqueuePos(0);
+static size_t dequeuePos = 0;
+
+static std::atomic<bool> running(false);
+static std::atomic<unsigned long> dropped(0);
+static std::thread writer;
+
+// Only touched by the writer thread while it runs
+static FILE* logFile = nullptr;
+static std::string logPath;
+static size_t logBytes = 0, logMaxBytes = 0;
+static unsigned int logMaxFiles = 0;
+
+static const char* levelNames[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+#define SLOT_INDEX(pos) ((pos) & (LOG_QUEUE_SIZE - 1))
+
+///
+/// Writer thread
+///
+static void Rotate()
+{
+	fclose(logFile);
+
+	for (unsigned int i = logMaxFiles; i > 1; --i)
+	{
+		std::string from = logPath + "." + std::to_string(i - 1);
+		std::string to = logPath + "." + std::to_string(i);
+		rename(from.c_str(), to.c_str());
+	}
+	rename(logPath.c_str(), (logPath + ".1").c_str());
+
+	logFile = fopen(logPath.c_str(), "w");
+	logBytes = 0;
+}
+
+static void WriteLine(int level, const char* text)
+{
+	printf("[%s] %s\n", levelNames[level], text);
+
+	if (!logFile)
+		return;
+
+	int length = fprintf(logFile, "[%s] %s\n", levelNames[level], text);
+	if (length > 0)
+		logBytes += length;
+
+	if (logMaxBytes && logBytes >= logMaxBytes)
+		Rotate();
+}
+
+// Returns how many messages were written
+static unsigned int Drain()
+{
+	unsigned int count = 0;
+
+	for (;;)
+	{
+		LogSlot& slot = queue[SLOT_INDEX(dequeuePos)];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire) + SLOT_INDEX(dequeuePos);
+		if (sequence != dequeuePos + 1)
+			break;
+
+		WriteLine(slot.level, slot.text);
+		slot.sequence.store(dequeuePos + LOG_QUEUE_SIZE - SLOT_INDEX(dequeuePos), std::memory_order_release);
+		++dequeuePos;
+		++count;
+	}
+
+	static unsigned long reported = 0;
+	unsigned long lost = dropped.load(std::memory_order_relaxed);
+	if (lost != reported)
+	{
+		char text[64];
+		snprintf(text, sizeof(text), "%lu log messages dropped, queue full", lost - reported);
+		WriteLine(LOG_LEVEL_WARNING, text);
+		reported = lost;
+	}
+
+	return count;
+}
+
+static void WriterLoop()
+{
+	Profiler::SetThreadName("Logger");
+
+	while (running.load(std::memory_order_acquire))
+	{
+		if (Drain())
+			continue;
+
+		// Only flush once caught up, never per message
+		{
+			PROFILE_ZONE("LogFlush");
+			fflush(stdout);
+			if (logFile)
+				fflush(logFile);
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(LOG_IDLE_MS));
+	}
+
+	Drain();
+}
+
+///
+/// Public interface
+///
+bool Logger::Start(const char* path, size_t maxBytes, unsigned int maxFiles)
+{
+	logPath = path;
+	logMaxBytes = maxBytes;
+	logMaxFiles = maxFiles;
+
+	logFile = fopen(path, "a");
+	if (logFile)
+	{
+		fseek(logFile, 0, SEEK_END);
+		logBytes = ftell(logFile);
+	}
+
+	running.store(true, std::memory_order_release);
+	writer = std::thread(WriterLoop);
+
+	return logFile != nullptr;
+}
+
+void Logger::Stop()
+{
+	if (!running.exchange(false))
+		return;
+
+	writer.join();
+
+	if (logFile)
+		fclose(logFile);
+	logFile = nullptr;
+	fflush(stdout);
+}
+
+void Logger::Write(int level, const char* format, ...)
+{
+	size_t pos = enqueuePos.load(std::memory_order_relaxed);
+	LogSlot* slot;
+
+	for (;;)
+	{
+		slot = &queue[SLOT_INDEX(pos)];
+		size_t sequence = slot->sequence.load(std::memory_order_acquire) + SLOT_INDEX(pos);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+		if (diff == 0)
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else
+			pos = enqueuePos.load(std::memory_order_relaxed);
+	}
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(slot->text, LOG_MESSAGE_SIZE, format, args);
+	va_end(args);
+	slot->level = level;
+
+	slot->sequence.store(pos + 1 - SLOT_INDEX(pos), std::memory_order_release);
+}
+
+unsigned long Logger::Dropped()
+{
+	return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,53 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <MappedFile.h>
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char *path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat info;
+	if (fstat(fd, &info) < 0 || info.st_size == 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (mapping == MAP_FAILED)
+		return 0;
+
+	data = (const unsigned char*)mapping;
+	size = info.st_size;
+	return 1;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		munmap((void*)data, size);
+
+	data = nullptr;
+	size = 0;
+}
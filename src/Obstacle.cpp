@@ -1,17 +1,8 @@
-#include <algorithm>
-
 #include <Obstacle.h>
 
 // Constructor
-Obstacle::Obstacle(bool s[], unsigned int d)
-{
-	std::copy(s, s+6, this->side);
-	this->distance = d;
-}
-
-// Move
-void Obstacle::Update(double speed)
+Obstacle::Obstacle(LaneMask b, Fixed p)
 {
-	this->distance -= speed;
-	//this->distance = 0;
+	this->blocked = b;
+	this->position = p;
 }
@@ -0,0 +1,95 @@
+#include <algorithm>
+
+#include <ObstacleTrack.h>
+
+ObstacleTrack::ObstacleTrack()
+{
+	head = colliding = 0;
+	travelled = 0;
+}
+
+void ObstacleTrack::Clear()
+{
+	obstacles.clear();
+	head = colliding = 0;
+	travelled = 0;
+}
+
+void ObstacleTrack::Reserve(size_t count)
+{
+	obstacles.reserve(count);
+}
+
+void ObstacleTrack::Add(LaneMask blocked, Fixed distance)
+{
+	// Passed slots first, then new memory
+	if (obstacles.size() == obstacles.capacity() && head)
+		Compact();
+
+	obstacles.push_back(Obstacle(blocked, travelled + distance));
+}
+
+unsigned int ObstacleTrack::Advance(Fixed amount)
+{
+	travelled += amount;
+
+	size_t passed = head;
+	while (head < obstacles.size() && Distance(obstacles[head]) < SIM_PASSED)
+		++head;
+	passed = head - passed;
+
+	if (colliding < head)
+		colliding = head;
+	while (colliding < obstacles.size() && Distance(obstacles[colliding]) < SIM_COLLIDES)
+		++colliding;
+
+	if (travelled > TRACK_REBASE)
+		Compact();
+
+	return passed;
+}
+
+// Drops passed obstacles and makes positions relative to the ship
+// again. Only differences of positions matter, so this changes nothing
+// the simulation can see.
+void ObstacleTrack::Compact()
+{
+	obstacles.erase(obstacles.begin(), obstacles.begin() + head);
+	colliding -= head;
+	head = 0;
+
+	for (Obstacle &o : obstacles)
+		o.position -= travelled;
+	travelled = 0;
+}
+
+ObstacleRange ObstacleTrack::All() const
+{
+	const Obstacle *base = obstacles.data();
+	return ObstacleRange(base + head, base + obstacles.size());
+}
+
+ObstacleRange ObstacleTrack::Colliding() const
+{
+	const Obstacle *base = obstacles.data();
+	return ObstacleRange(base + head, base + colliding);
+}
+
+ObstacleRange ObstacleTrack::Ahead() const
+{
+	const Obstacle *base = obstacles.data();
+	return ObstacleRange(base + colliding, base + obstacles.size());
+}
+
+static bool Before(const Obstacle &o, Fixed position)
+{
+	return o.position < position;
+}
+
+ObstacleRange ObstacleTrack::Within(Fixed near, Fixed far) const
+{
+	const Obstacle *first = obstacles.data() + head, *last = obstacles.data() + obstacles.size();
+	first = std::lower_bound(first, last, travelled + near, Before);
+	last = std::lower_bound(first, last, travelled + far, Before);
+	return ObstacleRange(first, last);
+}
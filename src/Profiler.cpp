@@ -0,0 +1,217 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+
+#include <Profiler.h>
+
+///
+/// Per-thread storage
+///
+struct ProfilerBuffer
+{
+	ProfilerZone zones[PROFILER_RING_SIZE];
+
+	// Total zones ever written. Only the owning thread writes it,
+	// Dump() reads it to know which slots are valid.
+	std::atomic<uint64_t> head;
+
+	// Written under registryMutex. A ring handed to a new thread keeps
+	// counting from 'head', its zones before 'first' belong to the
+	// thread that had it before.
+	uint64_t first;
+	unsigned int threadID;
+	const char* threadName;
+	bool inUse;
+};
+
+// Gives the ring back when its thread exits
+struct ProfilerOwner
+{
+	ProfilerBuffer* buffer;
+
+	~ProfilerOwner();
+};
+
+thread_local const char* Profiler::currentZone = nullptr;
+
+static std::mutex registryMutex;
+static std::vector<ProfilerBuffer*> registry;
+static unsigned int nextThreadID = 1;
+static thread_local ProfilerOwner localBuffer = { nullptr };
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+ProfilerOwner::~ProfilerOwner()
+{
+	if (!buffer)
+		return;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer->inUse = 0;
+}
+
+// Rings of threads that exited are reused before new ones are made,
+// so there are never more than the threads alive at once. Until then
+// their zones still make it into the dump.
+static ProfilerBuffer* GetLocalBuffer()
+{
+	if (localBuffer.buffer)
+		return localBuffer.buffer;
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	ProfilerBuffer* buffer = nullptr;
+	for (ProfilerBuffer* b : registry)
+	{
+		if (!b->inUse)
+		{
+			buffer = b;
+			break;
+		}
+	}
+
+	if (!buffer)
+	{
+		buffer = new ProfilerBuffer();
+		buffer->head.store(0, std::memory_order_relaxed);
+		registry.push_back(buffer);
+	}
+
+	buffer->first = buffer->head.load(std::memory_order_relaxed);
+	buffer->threadID = nextThreadID++;
+	buffer->threadName = nullptr;
+	buffer->inUse = 1;
+
+	localBuffer.buffer = buffer;
+	return buffer;
+}
+
+///
+/// Recording
+///
+uint64_t Profiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end)
+{
+	ProfilerBuffer* buffer = GetLocalBuffer();
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+
+	ProfilerZone& zone = buffer->zones[head & (PROFILER_RING_SIZE - 1)];
+	zone.name = name;
+	zone.start = start;
+	zone.end = end;
+
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+unsigned int Profiler::RecentZones(uint64_t since, ProfilerZone* out, unsigned int max)
+{
+	ProfilerBuffer* buffer = GetLocalBuffer();
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	uint64_t first = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+	if (first < buffer->first)
+		first = buffer->first;
+
+	// Zones are stored in the order they closed, so everything
+	// recorded before 'since' ends the walk
+	unsigned int count = 0;
+	for (uint64_t i = head; i > first && count < max; --i)
+	{
+		const ProfilerZone& zone = buffer->zones[(i - 1) & (PROFILER_RING_SIZE - 1)];
+		if (zone.end < since)
+			break;
+
+		if (zone.start >= since)
+			out[count++] = zone;
+	}
+
+	return count;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ProfilerBuffer* buffer = GetLocalBuffer();
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer->threadName = name;
+}
+
+///
+/// Chrome trace export
+///
+static void WriteEscaped(FILE* file, const char* str)
+{
+	for (; *str; ++str)
+	{
+		if (*str == '"' || *str == '\\')
+			fputc('\\', file);
+		fputc(*str, file);
+	}
+}
+
+bool Profiler::Dump(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return 0;
+
+	// Owner details as of now, a ring can change hands while we read
+	struct Snapshot
+	{
+		ProfilerBuffer* buffer;
+		uint64_t first;
+		unsigned int threadID;
+		const char* threadName;
+	};
+
+	std::vector<Snapshot> buffers;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (ProfilerBuffer* buffer : registry)
+			buffers.push_back({ buffer, buffer->first, buffer->threadID, buffer->threadName });
+	}
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+	fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Infinity Spectrum\"}}", file);
+
+	for (const Snapshot& snapshot : buffers)
+	{
+		ProfilerBuffer* buffer = snapshot.buffer;
+
+		if (snapshot.threadName)
+		{
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", snapshot.threadID);
+			WriteEscaped(file, snapshot.threadName);
+			fputs("\"}}", file);
+		}
+
+		// The owning thread may keep recording while we read. Slots it
+		// could have overwritten in the meantime are skipped, including
+		// the one it may be writing right now, before 'head' moves on.
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t first = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+		if (first < snapshot.first)
+			first = snapshot.first;
+
+		for (uint64_t i = first; i < head; ++i)
+		{
+			ProfilerZone zone = buffer->zones[i & (PROFILER_RING_SIZE - 1)];
+
+			uint64_t now = buffer->head.load(std::memory_order_acquire);
+			if (i + PROFILER_RING_SIZE <= now)
+				continue;
+
+			fputs(",\n{\"name\":\"", file);
+			WriteEscaped(file, zone.name);
+			fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				snapshot.threadID, zone.start / 1000.0, (zone.end - zone.start) / 1000.0);
+		}
+	}
+
+	fputs("\n]}\n", file);
+	return fclose(file) == 0;
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <RenderMetrics.h>
+
+unsigned long RenderMetrics::current[RENDER_COUNTER_COUNT];
+unsigned long RenderMetrics::history[METRICS_HISTORY_SIZE][RENDER_COUNTER_COUNT];
+unsigned long RenderMetrics::frame = 0;
+
+static const char* counterNames[RENDER_COUNTER_COUNT] = {
+	"draw_calls",
+	"program_binds",
+	"vao_binds",
+	"texture_binds",
+	"uniform_uploads",
+	"buffer_bytes",
+	"text_objects"
+};
+
+void RenderMetrics::EndFrame()
+{
+	memcpy(history[frame & (METRICS_HISTORY_SIZE - 1)], current, sizeof(current));
+	memset(current, 0, sizeof(current));
+	++frame;
+}
+
+const unsigned long* RenderMetrics::LastFrame()
+{
+	return history[(frame - 1) & (METRICS_HISTORY_SIZE - 1)];
+}
+
+const char* RenderMetrics::Name(RenderCounter counter)
+{
+	return counterNames[counter];
+}
+
+bool RenderMetrics::DumpCSV(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return 0;
+
+	fputs("frame", file);
+	for (int c = 0; c < RENDER_COUNTER_COUNT; ++c)
+		fprintf(file, ",%s", counterNames[c]);
+	fputc('\n', file);
+
+	unsigned long first = frame > METRICS_HISTORY_SIZE ? frame - METRICS_HISTORY_SIZE : 0;
+	for (unsigned long f = first; f < frame; ++f)
+	{
+		fprintf(file, "%lu", f);
+		for (int c = 0; c < RENDER_COUNTER_COUNT; ++c)
+			fprintf(file, ",%lu", history[f & (METRICS_HISTORY_SIZE - 1)][c]);
+		fputc('\n', file);
+	}
+
+	return fclose(file) == 0;
+}
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <Replay.h>
+#include <Simulation.h>
+#include <Profiler.h>
+#include <Logger.h>
+
+static_assert(sizeof(ReplayHeader) == 28, "ReplayHeader must not be padded");
+
+// Changes are this many bytes at most: 32 bits of delta plus 2 of input
+#define VARINT_MAX_BYTES 5
+
+static void PutVarint(std::vector<unsigned char> &out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+static bool GetVarint(const unsigned char *&in, const unsigned char *end, uint64_t &value)
+{
+	value = 0;
+	for (int shift = 0; in < end && shift < 7 * VARINT_MAX_BYTES; shift += 7)
+	{
+		unsigned char byte = *in++;
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return 1;
+	}
+	return 0;
+}
+
+///
+/// Recording
+///
+InputRecorder::InputRecorder() : writer("ReplayWriter")
+{
+	memset(&header, 0, sizeof(header));
+	lastTick = 0;
+	lastInput = 0;
+	recording = false;
+}
+
+InputRecorder::~InputRecorder()
+{
+	Wait();
+}
+
+void InputRecorder::Wait()
+{
+	if (saving.valid())
+		saving.wait();
+}
+
+void InputRecorder::Begin(uint32_t seed, unsigned short int difficulty, unsigned short int sides)
+{
+	memset(&header, 0, sizeof(header));
+	header.magic = REPLAY_MAGIC;
+	header.version = REPLAY_VERSION;
+	header.tickMs = SIM_TICK_MS;
+	header.seed = seed;
+	header.difficulty = difficulty;
+	header.sides = sides;
+
+	// Kept from the last game, so recording does not allocate
+	// during gameplay until a game outgrows it
+	stream.clear();
+	stream.reserve(REPLAY_RESERVE);
+	lastTick = 0;
+	lastInput = 0;
+	recording = true;
+}
+
+void InputRecorder::Record(uint32_t tick, int input)
+{
+	if (!recording || input == lastInput)
+		return;
+
+	PutVarint(stream, ((uint64_t)(tick - lastTick) << 2) | (input & 3));
+	lastTick = tick;
+	lastInput = input;
+}
+
+void InputRecorder::Save(const char* path, uint32_t ticks, unsigned int score)
+{
+	if (!recording)
+		return;
+	recording = false;
+
+	header.ticks = ticks;
+	header.score = score;
+	header.streamSize = stream.size();
+
+	ReplayHeader h = header;
+	std::vector<unsigned char> data = stream;
+	std::string file = path;
+
+	saving = writer.Push([h, data, file]()
+	{
+		PROFILE_ZONE("SaveReplay");
+
+		std::string temporary = file + ".tmp";
+		FILE* out = fopen(temporary.c_str(), "wb");
+
+		bool written = out != nullptr
+			&& fwrite(&h, sizeof(h), 1, out) == 1
+			&& (data.empty() || fwrite(&data[0], data.size(), 1, out) == 1);
+		if (out)
+			written = fclose(out) == 0 && written;
+
+		if (!written || rename(temporary.c_str(), file.c_str()) < 0)
+		{
+			remove(temporary.c_str());
+			LOG_ERROR("Failed to write replay %s", file.c_str());
+			return false;
+		}
+
+		LOG_INFO("Replay written to %s, %u ticks in %u bytes", file.c_str(), h.ticks, (unsigned int)(sizeof(h) + data.size()));
+		return true;
+	});
+}
+
+///
+/// Playback
+///
+InputPlayback::InputPlayback()
+{
+	memset(&header, 0, sizeof(header));
+	next = 0;
+	input = 0;
+}
+
+bool InputPlayback::Load(const char* path, std::string &error)
+{
+	FILE* in = fopen(path, "rb");
+	if (!in)
+	{
+		error = "cannot open file";
+		return 0;
+	}
+
+	std::vector<unsigned char> stream;
+	bool read = fread(&header, sizeof(header), 1, in) == 1
+		&& header.magic == REPLAY_MAGIC && header.version == REPLAY_VERSION
+		&& header.streamSize <= REPLAY_MAX_STREAM;
+	if (read)
+	{
+		stream.resize(header.streamSize);
+		read = stream.empty() || fread(&stream[0], stream.size(), 1, in) == 1;
+	}
+	fclose(in);
+
+	if (!read)
+	{
+		error = "not a replay, or truncated";
+		return 0;
+	}
+
+	if (header.tickMs != SIM_TICK_MS)
+	{
+		error = "recorded with another tick length";
+		return 0;
+	}
+
+	if (header.difficulty < 1 || header.difficulty > 3)
+	{
+		error = "unknown difficulty";
+		return 0;
+	}
+
+	if (header.sides != 4 && header.sides != 6 && header.sides != 8)
+	{
+		error = "unknown tunnel mode";
+		return 0;
+	}
+
+	changeTicks.clear();
+	changeInputs.clear();
+
+	const unsigned char *cursor = stream.data();
+	const unsigned char *end = cursor + stream.size();
+	uint64_t tick = 0;
+	while (cursor < end)
+	{
+		uint64_t value;
+		if (!GetVarint(cursor, end, value))
+		{
+			error = "damaged input stream";
+			return 0;
+		}
+
+		tick += value >> 2;
+		changeTicks.push_back((uint32_t)tick);
+		changeInputs.push_back(value & 3);
+	}
+
+	next = 0;
+	input = 0;
+	return 1;
+}
+
+int InputPlayback::Input(uint32_t tick)
+{
+	while (next < changeTicks.size() && changeTicks[next] <= tick)
+		input = changeInputs[next++];
+
+	return input;
+}
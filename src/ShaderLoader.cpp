@@ -10,105 +10,409 @@
 #include <algorithm>
 using namespace std;
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #define GL_GLEXT_PROTOTYPES 1
 #define GL3_PROTOTYPES 1
 
+#include <SDL.h>
 #include <GL/glut.h>
 #include <GL/gl.h>
 
 #include <ShaderLoader.h>
+#include <AssetPack.h>
+#include <MappedFile.h>
+#include <Profiler.h>
+#include <Logger.h>
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+///
+/// Program binary cache. One file per vertex/fragment pair, in
+/// shadercache/ next to the executable. The key covers both sources
+/// and the driver, so editing a shader or updating the driver simply
+/// misses and overwrites the entry.
+///
+#define SHADER_CACHE_MAGIC 0x48435349 // "ISCH"
+#define SHADER_CACHE_VERSION 1
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+struct ShaderCacheHeader
+{
+	uint32_t magic, version;
+	uint64_t key;
+	uint32_t format, size;
+};
+
+// FNV-1a
+static uint64_t Hash(uint64_t hash, const char *data, size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static uint64_t Hash(uint64_t hash, const char *str)
+{
+	// Includes the terminator, so "ab" + "c" differs from "a" + "bc"
+	return Hash(hash, str ? str : "", str ? strlen(str) + 1 : 1);
+}
+
+static bool ProgramBinarySupported()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		supported = formats > 0;
+	}
+	return supported;
+}
+
+static std::string ShaderCachePath(const char * vertex_file_path, const char * fragment_file_path)
+{
+	static std::string directory;
+	if (directory.empty())
+	{
+		char *base = SDL_GetBasePath();
+		directory = std::string(base ? base : "./") + "shadercache/";
+		SDL_free(base);
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)Hash(Hash(0xcbf29ce484222325ULL, vertex_file_path), fragment_file_path));
+	return directory + name;
+}
+
+// Source text, either pointing into the asset pack or into 'storage'
+struct ShaderSource
+{
+	const char *code;
+	GLint length;
+	std::string storage;
+};
+
+static uint64_t Hash(uint64_t hash, const ShaderSource &source)
+{
+	hash = Hash(hash, (const char*)&source.length, sizeof(source.length));
+	return Hash(hash, source.code, source.length);
+}
+
+static uint64_t ShaderCacheKey(const ShaderSource &vertexSource, const ShaderSource &fragmentSource)
+{
+	uint64_t key = 0xcbf29ce484222325ULL;
+	key = Hash(key, vertexSource);
+	key = Hash(key, fragmentSource);
+	key = Hash(key, (const char*)glGetString(GL_VENDOR));
+	key = Hash(key, (const char*)glGetString(GL_RENDERER));
+	key = Hash(key, (const char*)glGetString(GL_VERSION));
+	return key;
+}
+
+// Returns 0 on a miss, or when the driver rejects the binary
+static GLuint LoadCachedProgram(const std::string &path, uint64_t key)
+{
+	PROFILE_ZONE("LoadCachedProgram");
+
+	MappedFile file;
+	if (!file.Open(path.c_str()) || file.Size() < sizeof(ShaderCacheHeader))
+		return 0;
+
+	const ShaderCacheHeader *header = (const ShaderCacheHeader*)file.Data();
+	if (header->magic != SHADER_CACHE_MAGIC || header->version != SHADER_CACHE_VERSION
+		|| header->key != key || header->size != file.Size() - sizeof(ShaderCacheHeader))
+		return 0;
+
+	GLuint ProgramID = glCreateProgram();
+	glProgramBinary(ProgramID, header->format, file.Data() + sizeof(ShaderCacheHeader), header->size);
+
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if (Result != GL_TRUE)
+	{
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+
+	return ProgramID;
+}
+
+static void SaveCachedProgram(const std::string &path, uint64_t key, GLuint ProgramID)
+{
+	PROFILE_ZONE("SaveCachedProgram");
+
+	GLint size = 0;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0)
+		return;
+
+	std::vector<char> binary(size);
+	ShaderCacheHeader header;
+	GLenum format = 0;
+	glGetProgramBinary(ProgramID, size, &size, &format, &binary[0]);
+
+	header.magic = SHADER_CACHE_MAGIC;
+	header.version = SHADER_CACHE_VERSION;
+	header.key = key;
+	header.format = format;
+	header.size = size;
+
+	std::string directory = path.substr(0, path.rfind('/'));
+	mkdir(directory.c_str(), 0755);
+
+	// Written aside and renamed, a crash never leaves a torn entry
+	std::string temporary = path + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file)
+	{
+		LOG_WARNING("Cannot write shader cache %s", temporary.c_str());
+		return;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(&binary[0], size, 1, file) == 1;
+	written = (fclose(file) == 0) && written;
+
+	if (!written || rename(temporary.c_str(), path.c_str()) < 0)
+	{
+		remove(temporary.c_str());
+		LOG_WARNING("Cannot write shader cache %s", path.c_str());
+	}
+}
+
+// Straight from the asset pack, or the whole file in one read
+static bool ReadShaderFile(const char * path, ShaderSource &source)
+{
+	const unsigned char *data;
+	size_t size;
+	if (AssetPack::Find(path, data, size))
+	{
+		source.code = (const char*)data;
+		source.length = size;
+		return 1;
+	}
+
+	std::ifstream stream(path, std::ios::in | std::ios::binary);
+	if (!stream.is_open())
+		return 0;
+
+	stream.seekg(0, std::ios::end);
+	std::streamoff length = stream.tellg();
+	if (length < 0)
+		return 0;
+
+	source.storage.resize(length);
+	stream.seekg(0, std::ios::beg);
+	stream.read(&source.storage[0], length);
+
+	source.code = source.storage.c_str();
+	source.length = length;
+	return 1;
+}
+
+///
+/// Parallel compilation (KHR/ARB_parallel_shader_compile)
+///
+typedef void (APIENTRY *MaxShaderCompilerThreadsProc)(GLuint count);
+
+static bool HasExtension(const char *name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i)
+	{
+		const char *extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && !strcmp(extension, name))
+			return 1;
+	}
+	return 0;
+}
+
+// Without the extension, status queries block until the driver is done
+static bool ParallelCompileSupported()
+{
+	static int supported = -1;
+	if (supported >= 0)
+		return supported;
+
+	MaxShaderCompilerThreadsProc maxThreads = nullptr;
+	if (HasExtension("GL_KHR_parallel_shader_compile"))
+		maxThreads = (MaxShaderCompilerThreadsProc)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+	else if (HasExtension("GL_ARB_parallel_shader_compile"))
+		maxThreads = (MaxShaderCompilerThreadsProc)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsARB");
+
+	// Let the driver use as many threads as it likes
+	if (maxThreads)
+		maxThreads(0xFFFFFFFF);
+
+	supported = maxThreads != nullptr;
+	LOG_DEBUG("Parallel shader compilation: %s", supported ? "yes" : "no");
+	return supported;
+}
+
+///
+/// Loading
+///
+bool BeginLoadShaders(const char * vertex_file_path, const char * fragment_file_path, ShaderProgramBuild &build){
+
+	PROFILE_ZONE("BeginLoadShaders");
+
+	build.program = build.vertexShader = build.fragmentShader = 0;
+	build.vertexPath = vertex_file_path;
+	build.fragmentPath = fragment_file_path;
+	build.cached = false;
 
 	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}else{
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
+	ShaderSource VertexShaderCode;
+	if(!ReadShaderFile(vertex_file_path, VertexShaderCode)){
+		LOG_ERROR("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !", vertex_file_path);
 		getchar();
 		return 0;
 	}
 
 	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+	ShaderSource FragmentShaderCode;
+	if(!ReadShaderFile(fragment_file_path, FragmentShaderCode)){
+		FragmentShaderCode.code = "";
+		FragmentShaderCode.length = 0;
 	}
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+	// Warm start: reuse the program linked on a previous launch
+	build.useCache = ProgramBinarySupported();
+	if (build.useCache){
+		build.cachePath = ShaderCachePath(vertex_file_path, fragment_file_path);
+		build.cacheKey = ShaderCacheKey(VertexShaderCode, FragmentShaderCode);
+
+		build.program = LoadCachedProgram(build.cachePath, build.cacheKey);
+		if (build.program){
+			LOG_DEBUG("Loaded program from cache : %s, %s", vertex_file_path, fragment_file_path);
+			build.cached = true;
+			return 1;
+		}
+	}
 
+	// Hint the driver before the first compile
+	ParallelCompileSupported();
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
+	// Submit everything, statuses are only queried in FinishLoadShaders
+	LOG_DEBUG("Compiling shader : %s", vertex_file_path);
+	build.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(build.vertexShader, 1, &VertexShaderCode.code, &VertexShaderCode.length);
+	glCompileShader(build.vertexShader);
+
+	LOG_DEBUG("Compiling shader : %s", fragment_file_path);
+	build.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(build.fragmentShader, 1, &FragmentShaderCode.code, &FragmentShaderCode.length);
+	glCompileShader(build.fragmentShader);
+
+	LOG_DEBUG("Linking program");
+	build.program = glCreateProgram();
+	if (build.useCache)
+		glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(build.program, build.vertexShader);
+	glAttachShader(build.program, build.fragmentShader);
+	glLinkProgram(build.program);
+
+	return 1;
+}
+
+bool IsShaderProgramReady(const ShaderProgramBuild &build){
 
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (build.cached || !build.program || !ParallelCompileSupported())
+		return 1;
+
+	GLint Completed = GL_FALSE;
+	glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &Completed);
+	return Completed == GL_TRUE;
+}
+
+static void LogShaderInfo(GLuint ShaderID){
+
+	int InfoLogLength;
+	glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
+		std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		LOG_WARNING("%s", &ShaderErrorMessage[0]);
 	}
+}
 
+GLuint FinishLoadShaders(ShaderProgramBuild &build){
 
+	PROFILE_ZONE("FinishLoadShaders");
 
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
+	if (build.cached || !build.program)
+		return build.program;
 
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	// Check the shaders
+	LogShaderInfo(build.vertexShader);
+	LogShaderInfo(build.fragmentShader);
+
+	// Check the program
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+	glGetProgramiv(build.program, GL_LINK_STATUS, &Result);
+	glGetProgramiv(build.program, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
+		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
+		glGetProgramInfoLog(build.program, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		LOG_WARNING("%s", &ProgramErrorMessage[0]);
 	}
 
+	glDetachShader(build.program, build.vertexShader);
+	glDetachShader(build.program, build.fragmentShader);
+
+	glDeleteShader(build.vertexShader);
+	glDeleteShader(build.fragmentShader);
+	build.vertexShader = build.fragmentShader = 0;
 
+	if (build.useCache && Result == GL_TRUE)
+		SaveCachedProgram(build.cachePath, build.cacheKey, build.program);
+
+	return build.program;
+}
+
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+
+	PROFILE_ZONE("LoadShaders");
+
+	ShaderProgramBuild build;
+	if (!BeginLoadShaders(vertex_file_path, fragment_file_path, build))
+		return 0;
+
+	return FinishLoadShaders(build);
+}
+
+GLuint LoadShaderSource(const char * vertex_source, const char * fragment_source){
+
+	PROFILE_ZONE("LoadShaderSource");
+
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(VertexShaderID, 1, &vertex_source, NULL);
+	glCompileShader(VertexShaderID);
+
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(FragmentShaderID, 1, &fragment_source, NULL);
+	glCompileShader(FragmentShaderID);
 
-	// Link the program
-	printf("Linking program\n");
 	GLuint ProgramID = glCreateProgram();
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
 	glLinkProgram(ProgramID);
 
-	// Check the program
+	GLint Result = GL_FALSE;
 	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-		printf("%s\n", &ProgramErrorMessage[0]);
+	if (Result != GL_TRUE){
+		LogShaderInfo(VertexShaderID);
+		LogShaderInfo(FragmentShaderID);
 	}
 
-	
 	glDetachShader(ProgramID, VertexShaderID);
 	glDetachShader(ProgramID, FragmentShaderID);
-	
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
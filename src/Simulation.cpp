@@ -0,0 +1,258 @@
+#include <Simulation.h>
+#include <Solvability.h>
+#include <Profiler.h>
+#include <Logger.h>
+
+Simulation::Simulation()
+{
+	random = 1;
+	difficulty = 1;
+	movementSpeed = FIXED_ONE;
+	tunnelRotation = 0;
+	score = 0;
+	tick = 0;
+	passed = 0;
+	sides = TUNNEL_DEFAULT_SIDES;
+	reachableLanes = Tunnel<TUNNEL_DEFAULT_SIDES>::allLanes;
+	lastType = -1;
+	nextDistance = 0;
+	lookahead = SIM_LOOKAHEAD;
+}
+
+///
+/// Called every time the game starts
+///
+void Simulation::Reset(unsigned short int d, uint32_t seed, unsigned short int s)
+{
+	difficulty = d;
+	sides = s;
+	random = seed ? seed : 1;
+	tunnelRotation = 0;
+	score = 0;
+	tick = 0;
+	passed = 0;
+
+	movementSpeed = MovementSpeed(d);
+	switch (sides)
+	{
+		case 4:
+			reachableLanes = Solvability<4>::Tables().Start(d);
+			break;
+		case 8:
+			reachableLanes = Solvability<8>::Tables().Start(d);
+			break;
+		default:
+			reachableLanes = Solvability<6>::Tables().Start(d);
+			break;
+	}
+	lastType = -1;
+	nextDistance = FirstObstacle(d);
+
+	// Everything from behind the ship to a chunk past the lookahead.
+	// Passed obstacles free their slots for later chunks, so this is
+	// the only allocation of a game.
+	track.Clear();
+	track.Reserve((lookahead - SIM_PASSED) / ObstacleSpacing(d) + 1 + SIM_CHUNK);
+	GenerateAhead();
+}
+
+void Simulation::SetLookahead(Fixed distance)
+{
+	lookahead = distance > 0 ? distance : SIM_LOOKAHEAD;
+}
+
+///
+/// Per difficulty constants, shared with Solvability
+///
+Fixed Simulation::MovementSpeed(unsigned short int d)
+{
+	switch (d)
+	{
+		case 2:
+			return 13 * FIXED_ONE / 10;
+		case 3:
+			return 16 * FIXED_ONE / 10;
+		default:
+			return FIXED_ONE;
+	}
+}
+
+// 30 degrees per second at base speed
+Fixed Simulation::RotationSpeed(unsigned short int d)
+{
+	return SIM_TICK_MS * MovementSpeed(d) * 3 / 100;
+}
+
+// 1.8 units per second for each difficulty level
+Fixed Simulation::ObstacleSpeed(unsigned short int d)
+{
+	return SIM_TICK_MS * d * 18 * FIXED_ONE / 10000;
+}
+
+Fixed Simulation::ObstacleSpacing(unsigned short int d)
+{
+	switch (d)
+	{
+		case 2:
+			return 16 * FIXED_ONE;
+		case 3:
+			return 28 * FIXED_ONE;
+		default:
+			return 11 * FIXED_ONE;
+	}
+}
+
+Fixed Simulation::FirstObstacle(unsigned short int d)
+{
+	switch (d)
+	{
+		case 2:
+			return 40 * FIXED_ONE;
+		case 3:
+			return 58 * FIXED_ONE;
+		default:
+			return 16 * FIXED_ONE;
+	}
+}
+
+int Simulation::ChooseType(uint32_t random, int lastType, int types)
+{
+	int type = random % types;
+
+	// Trick to make level seem slightly more random
+	if (type-3 == lastType || type == lastType || type+3 == lastType)
+	{
+		type = (type + 1) % types;
+	}
+
+	return type;
+}
+
+///
+/// Generates random obstacles, a chunk at a time, until the level
+/// reaches past the lookahead
+///
+void Simulation::GenerateAhead()
+{
+	if (nextDistance >= lookahead)
+		return;
+
+	PROFILE_ZONE("GenerateObstacles");
+
+	while (nextDistance < lookahead)
+	{
+		switch (sides)
+		{
+			case 4:
+				GenerateChunk<4>();
+				break;
+			case 8:
+				GenerateChunk<8>();
+				break;
+			default:
+				GenerateChunk<6>();
+				break;
+		}
+	}
+}
+
+template <int Sides>
+void Simulation::GenerateChunk()
+{
+	typedef Tunnel<Sides> T;
+	const Solvability<Sides> &solvability = Solvability<Sides>::Tables();
+
+	for (unsigned int i = 0; i < SIM_CHUNK; ++i)
+	{
+		int type = ChooseType(NextRandom(random), lastType, T::Types());
+
+		// Never ask for a lane the player can't get to in time. With
+		// the current speeds and spacing every type passes this.
+		LaneMask lanes = solvability.Next(difficulty, reachableLanes, T::Open(type));
+		for (int k = 1; !lanes && k < T::Types(); ++k)
+		{
+			int other = (type + k) % T::Types();
+			lanes = solvability.Next(difficulty, reachableLanes, T::Open(other));
+			if (lanes)
+			{
+				LOG_DEBUG("Obstacle type %d can't be reached, using %d", type, other);
+				type = other;
+			}
+		}
+		reachableLanes = lanes;
+		lastType = type;
+
+		// Exactly one spacing behind the one before, however long the game
+		track.Add(T::Blocked(type), nextDistance);
+		nextDistance += ObstacleSpacing(difficulty);
+	}
+}
+
+// Whether anything that can hit blocks the ship's lane. Masks are
+// merged first, so there is one test however many there are.
+template <int Sides>
+bool Simulation::Collides(int lane) const
+{
+	LaneMask blocked = 0;
+	for (const Obstacle &o : track.Colliding())
+		blocked |= o.blocked;
+
+	return Tunnel<Sides>::Blocks(blocked, lane);
+}
+
+///
+/// One tick of gameplay
+///
+bool Simulation::Step(int input)
+{
+	++tick;
+
+	// Both keys held cancel out
+	int dir = ((input & SIM_INPUT_RIGHT) ? 1 : 0) - ((input & SIM_INPUT_LEFT) ? 1 : 0);
+	tunnelRotation += dir * RotationSpeed(difficulty);
+
+	if (tunnelRotation >= 360 * FIXED_ONE)
+		tunnelRotation -= 360 * FIXED_ONE;
+
+	if (tunnelRotation < 0)
+		tunnelRotation += 360 * FIXED_ONE;
+
+	Fixed obstacleSpeed = ObstacleSpeed(difficulty);
+
+	// Obstacle is past camera
+	unsigned int gone = track.Advance(obstacleSpeed);
+	score += gone * (100 * movementSpeed / FIXED_ONE);
+	passed += gone;
+
+	// Collision detection
+	int pos;
+	bool hit;
+	switch (sides)
+	{
+		case 4:
+			pos = Tunnel<4>::Lane(tunnelRotation);
+			hit = Collides<4>(pos);
+			break;
+		case 8:
+			pos = Tunnel<8>::Lane(tunnelRotation);
+			hit = Collides<8>(pos);
+			break;
+		default:
+			pos = Tunnel<6>::Lane(tunnelRotation);
+			hit = Collides<6>(pos);
+			break;
+	}
+
+	if (hit)
+	{
+		LOG_DEBUG("Collision at tick %u. Angle: %.3f, wall pos: %d", tick, FixedToFloat(tunnelRotation), pos);
+		return 1;
+	}
+
+	nextDistance -= obstacleSpeed;
+
+	// New ones at the far end, not moved until the next tick
+	GenerateAhead();
+
+	return 0;
+}
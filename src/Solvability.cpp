@@ -0,0 +1,174 @@
+#include <vector>
+
+#include <Solvability.h>
+#include <Simulation.h>
+#include <Logger.h>
+
+#define FULL_TURN (360 * FIXED_ONE)
+
+static Fixed GCD(Fixed a, Fixed b)
+{
+	while (b)
+	{
+		Fixed t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// First and last tick an obstacle 'distance' away can hit the ship,
+// counting the tick it moves for the first time as 1
+static void Window(Fixed distance, Fixed speed, uint32_t &first, uint32_t &last)
+{
+	first = last = 0;
+	for (uint32_t t = 1; ; ++t)
+	{
+		distance -= speed;
+		if (distance < SIM_PASSED)
+			return;
+		if (distance < SIM_COLLIDES)
+		{
+			if (!first)
+				first = t;
+			last = t;
+		}
+	}
+}
+
+template <int Sides>
+const Solvability<Sides>& Solvability<Sides>::Tables()
+{
+	static const Solvability tables;
+	return tables;
+}
+
+template <int Sides>
+Solvability<Sides>::Solvability()
+{
+	for (unsigned short int d = 1; d <= 3; ++d)
+		Build(d);
+}
+
+template <int Sides>
+void Solvability<Sides>::Build(unsigned short int d)
+{
+	typedef Tunnel<Sides> T;
+
+	Fixed rotation = Simulation::RotationSpeed(d);
+	Fixed speed = Simulation::ObstacleSpeed(d);
+	Fixed spacing = Simulation::ObstacleSpacing(d);
+
+	// The tunnel only ever stops at multiples of 'grain'
+	Fixed grain = GCD(rotation, FULL_TURN);
+	uint32_t points = FULL_TURN / grain;
+	uint32_t step = rotation / grain;
+
+	// Fewest ticks to turn by each multiple of 'grain', either way
+	std::vector<uint32_t> turnTicks(points, UINT32_MAX);
+	std::vector<uint32_t> queue;
+	queue.reserve(points);
+	turnTicks[0] = 0;
+	queue.push_back(0);
+	for (size_t i = 0; i < queue.size(); ++i)
+	{
+		uint32_t p = queue[i];
+		uint32_t next[2] = { (p + step) % points, (p + points - step) % points };
+		for (uint32_t n : next)
+		{
+			if (turnTicks[n] == UINT32_MAX)
+			{
+				turnTicks[n] = turnTicks[p] + 1;
+				queue.push_back(n);
+			}
+		}
+	}
+
+	// Each lane holds a run of consecutive points, wrapping past 0 for
+	// lane 0. Lanes need not be a whole number of grains wide, so the
+	// runs are counted rather than worked out.
+	uint32_t laneFirst[Sides], laneCount[Sides];
+	for (int a = 0; a < Sides; ++a)
+		laneFirst[a] = laneCount[a] = 0;
+	for (uint32_t p = 0; p < points; ++p)
+	{
+		int a = T::Lane(p * grain);
+		++laneCount[a];
+		if (T::Lane((p + points - 1) % points * grain) != a)
+			laneFirst[a] = p;
+	}
+
+	// From anywhere in each lane to anywhere in each other. Every turn
+	// between two runs is one of a run of consecutive offsets.
+	uint32_t (*ticks)[Sides] = laneTicks[d - 1];
+	for (int a = 0; a < Sides; ++a)
+	{
+		for (int b = 0; b < Sides; ++b)
+		{
+			uint32_t span = laneCount[a] + laneCount[b] - 1;
+			if (span > points)
+				span = points;
+			uint32_t offset = (laneFirst[b] + points - (laneFirst[a] + laneCount[a] - 1) % points) % points;
+
+			ticks[a][b] = UINT32_MAX;
+			for (uint32_t k = 0; k < span; ++k)
+			{
+				uint32_t t = turnTicks[(offset + k) % points];
+				if (t < ticks[a][b])
+					ticks[a][b] = t;
+			}
+		}
+	}
+
+	// Obstacles move in steps of 'speed' from a multiple of a unit,
+	// so only a few phases happen. The worst one counts.
+	Fixed phases = speed / GCD(FIXED_ONE, speed);
+	moveTicks[d - 1] = UINT32_MAX;
+	for (Fixed phase = 0; phase < phases; ++phase)
+	{
+		Fixed distance = spacing + phase * FIXED_ONE;
+		uint32_t first, last, nextFirst, nextLast;
+		Window(distance, speed, first, last);
+		Window(distance + spacing, speed, nextFirst, nextLast);
+		if (nextFirst - last < moveTicks[d - 1])
+			moveTicks[d - 1] = nextFirst - last;
+	}
+
+	LaneMask reach[Sides];
+	for (int a = 0; a < Sides; ++a)
+	{
+		reach[a] = 0;
+		for (int b = 0; b < Sides; ++b)
+		{
+			if (ticks[a][b] <= moveTicks[d - 1])
+				reach[a] |= 1 << b;
+		}
+	}
+
+	for (int lanes = 0; lanes < (1 << Sides); ++lanes)
+	{
+		expand[d - 1][lanes] = 0;
+		for (int a = 0; a < Sides; ++a)
+		{
+			if (lanes & (1 << a))
+				expand[d - 1][lanes] |= reach[a];
+		}
+	}
+
+	// Games start at rotation 0, exactly
+	uint32_t first, last;
+	Window(Simulation::FirstObstacle(d), speed, first, last);
+	start[d - 1] = 0;
+	for (uint32_t q = 0; q < points; ++q)
+	{
+		if (turnTicks[q] <= first)
+			start[d - 1] |= 1 << T::Lane(q * grain);
+	}
+
+	LOG_DEBUG("%d sides, difficulty %u: %u ticks between obstacles, the next lane over takes %u",
+		Sides, d, moveTicks[d - 1], ticks[0][1]);
+}
+
+template class Solvability<4>;
+template class Solvability<6>;
+template class Solvability<8>;
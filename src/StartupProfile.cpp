@@ -0,0 +1,70 @@
+#include <stdio.h>
+
+#include <StartupProfile.h>
+#include <Logger.h>
+
+StartupPhase StartupProfile::phases[STARTUP_MAX_PHASES];
+unsigned int StartupProfile::count = 0;
+uint64_t StartupProfile::firstFrame = 0;
+uint64_t StartupProfile::firstScreenFrame = 0;
+
+void StartupProfile::Record(const char* name, uint64_t start, uint64_t end)
+{
+	if (firstScreenFrame || count >= STARTUP_MAX_PHASES)
+		return;
+
+	phases[count].name = name;
+	phases[count].start = start;
+	phases[count].end = end;
+	++count;
+}
+
+void StartupProfile::FramePresented(bool loading)
+{
+	uint64_t now = Profiler::Now();
+
+	if (!firstFrame)
+		firstFrame = now;
+
+	if (!loading && !firstScreenFrame)
+		firstScreenFrame = now;
+}
+
+bool StartupProfile::Complete()
+{
+	return firstScreenFrame != 0;
+}
+
+///
+/// Output
+///
+void StartupProfile::Report()
+{
+	// Phases are recorded as they end, nested ones before their parent
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		LOG_INFO("Startup: %-16s %8.1f ms (from %.1f ms)", phases[i].name,
+			(phases[i].end - phases[i].start) / 1e6, phases[i].start / 1e6);
+	}
+
+	LOG_INFO("Startup: first frame presented at %.1f ms, first screen frame at %.1f ms",
+		firstFrame / 1e6, firstScreenFrame / 1e6);
+}
+
+bool StartupProfile::AppendCSV(const char* path, const char* label)
+{
+	FILE* file = fopen(path, "a");
+	if (!file)
+		return 0;
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		fprintf(file, "%s,%s,%.3f,%.3f\n", label, phases[i].name,
+			phases[i].start / 1e6, (phases[i].end - phases[i].start) / 1e6);
+	}
+
+	fprintf(file, "%s,first_frame,0,%.3f\n", label, firstFrame / 1e6);
+	fprintf(file, "%s,first_screen_frame,0,%.3f\n", label, firstScreenFrame / 1e6);
+
+	return fclose(file) == 0;
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include <StutterDetector.h>
+
+// Weight of the newest sample in a zone's typical duration
+#define STUTTER_EMA_WEIGHT 0.05
+
+// A child zone takes the blame when it explains at
+// least this share of its parent's overrun
+#define STUTTER_CHILD_SHARE 0.5
+
+StutterDetector::StutterDetector()
+{
+	budget = 2.0;
+	historyCount = 0;
+	frame = 0;
+	spikeCount = 0;
+	memset(zoneNames, 0, sizeof(zoneNames));
+	memset(zoneTypical, 0, sizeof(zoneTypical));
+}
+
+void StutterDetector::SetBudget(double medianMultiplier)
+{
+	budget = medianMultiplier;
+}
+
+unsigned long StutterDetector::Spikes()
+{
+	return spikeCount;
+}
+
+///
+/// Helpers
+///
+double* StutterDetector::Typical(const char* name)
+{
+	for (int i = 0; i < STUTTER_MAX_ZONE_NAMES; ++i)
+	{
+		if (zoneNames[i] == name)
+			return &zoneTypical[i];
+
+		if (!zoneNames[i])
+		{
+			zoneNames[i] = name;
+			return &zoneTypical[i];
+		}
+	}
+
+	return nullptr;
+}
+
+uint64_t StutterDetector::Median()
+{
+	uint64_t sorted[STUTTER_HISTORY];
+	unsigned int count = std::min(historyCount, (unsigned int)STUTTER_HISTORY);
+	std::copy(history, history + count, sorted);
+	std::nth_element(sorted, sorted + count / 2, sorted + count);
+	return sorted[count / 2];
+}
+
+// Starts from the zone furthest over its typical duration and
+// walks down into children while one of them explains most of it
+const ProfilerZone* StutterDetector::Blame(unsigned int zoneCount, double* excess)
+{
+	const ProfilerZone* blamed = nullptr;
+	double blamedExcess = 0;
+
+	for (;;)
+	{
+		const ProfilerZone* next = nullptr;
+		double nextExcess = blamed ? blamedExcess * STUTTER_CHILD_SHARE : 0;
+
+		for (unsigned int i = 0; i < zoneCount; ++i)
+		{
+			const ProfilerZone& zone = frameZones[i];
+			if (&zone == blamed)
+				continue;
+
+			if (blamed && (zone.start < blamed->start || zone.end > blamed->end))
+				continue;
+
+			double* typical = Typical(zone.name);
+			double zoneExcess = (zone.end - zone.start) - (typical ? *typical : 0);
+			if (zoneExcess > nextExcess)
+			{
+				next = &zone;
+				nextExcess = zoneExcess;
+			}
+		}
+
+		if (!next)
+			break;
+
+		blamed = next;
+		blamedExcess = nextExcess;
+	}
+
+	*excess = blamedExcess;
+	return blamed;
+}
+
+///
+/// Per frame
+///
+bool StutterDetector::EndFrame(uint64_t frameStart, uint64_t frameEnd, const SpikeContext& context)
+{
+	uint64_t frameTime = frameEnd - frameStart;
+	unsigned int zoneCount = Profiler::RecentZones(frameStart, frameZones, STUTTER_MAX_FRAME_ZONES);
+
+	bool spike = 0;
+	if (historyCount >= STUTTER_WARMUP)
+	{
+		uint64_t median = Median();
+		spike = frameTime > median * budget;
+
+		if (spike)
+		{
+			double excess;
+			const ProfilerZone* zone = Blame(zoneCount, &excess);
+
+			SpikeRecord& record = spikes[spikeCount % STUTTER_MAX_SPIKES];
+			record.frame = frame;
+			record.frameMs = frameTime / 1e6;
+			record.medianMs = median / 1e6;
+			record.zone = zone ? zone->name : nullptr;
+			record.zoneMs = zone ? (zone->end - zone->start) / 1e6 : 0;
+			record.zoneExcessMs = excess / 1e6;
+			record.context = context;
+			++spikeCount;
+		}
+	}
+
+	// Spikes stay out of the baselines, so one hitch
+	// does not hide the next one
+	if (!spike)
+	{
+		history[historyCount % STUTTER_HISTORY] = frameTime;
+		++historyCount;
+
+		for (unsigned int i = 0; i < zoneCount; ++i)
+		{
+			double* typical = Typical(frameZones[i].name);
+			if (typical)
+				*typical += (double(frameZones[i].end - frameZones[i].start) - *typical) * STUTTER_EMA_WEIGHT;
+		}
+	}
+
+	++frame;
+	return spike;
+}
+
+bool StutterDetector::DumpLog(const char* path)
+{
+	FILE* file = fopen(path, "a");
+	if (!file)
+		return 0;
+
+	unsigned long first = spikeCount > STUTTER_MAX_SPIKES ? spikeCount - STUTTER_MAX_SPIKES : 0;
+	for (unsigned long i = first; i < spikeCount; ++i)
+	{
+		const SpikeRecord& r = spikes[i % STUTTER_MAX_SPIKES];
+		fprintf(file, "frame=%lu ms=%.2f median=%.2f zone=%s zone_ms=%.2f over=%.2f state=%u obstacles=%u allocs=%lu\n",
+			r.frame, r.frameMs, r.medianMs, r.zone ? r.zone : "?", r.zoneMs, r.zoneExcessMs,
+			r.context.gameState, r.context.obstacles, r.context.allocs);
+	}
+
+	return fclose(file) == 0;
+}
@@ -1,31 +1,364 @@
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <memory>
+#include <vector>
 #include <stdio.h>
+#include <string.h>
 #include <GL/gl.h>
 #include "stb_image.h"
 
-GLuint LoadTexture(const char * bitmap_file)
+#include <TextureLoader.h>
+#include <AssetPack.h>
+#include <BakedTexture.h>
+#include <MappedFile.h>
+#include <Profiler.h>
+#include <Logger.h>
+#include <TextureStreamer.h>
+
+// GL_EXT_texture_filter_anisotropic, core since 4.6
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+TextureSampler::TextureSampler()
+    : minFilter(GL_LINEAR_MIPMAP_LINEAR), magFilter(GL_LINEAR),
+      wrapS(GL_MIRRORED_REPEAT), wrapT(GL_MIRRORED_REPEAT),
+      mipmaps(true), anisotropy(1.f)
 {
-    GLuint texture = 0;
+}
+
+// Queried once, 0 when the extension is missing
+static GLfloat MaxAnisotropy()
+{
+    static GLfloat maxAnisotropy = -1.f;
+    if (maxAnisotropy >= 0.f)
+        return maxAnisotropy;
 
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load( bitmap_file, &width, &height, &nrChannels, 0);
+    maxAnisotropy = 0.f;
 
-    if (nrChannels == 0)
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
     {
-        fprintf(stderr, "%s: error loading bitmap file\n", bitmap_file);
-        return -1;
+        const char *name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (name && (!strcmp(name, "GL_EXT_texture_filter_anisotropic") || !strcmp(name, "GL_ARB_texture_filter_anisotropic")))
+        {
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+            break;
+        }
+    }
+
+    LOG_DEBUG("Max texture anisotropy: %.0f", maxAnisotropy);
+    return maxAnisotropy;
+}
+
+static void ApplySampler(GLenum target, const TextureSampler &sampler, bool hasMipmaps)
+{
+    GLenum minFilter = sampler.minFilter;
+
+    // A mipmapped filter on a texture without levels samples as incomplete (black)
+    if (!hasMipmaps && minFilter != GL_NEAREST && minFilter != GL_LINEAR)
+        minFilter = (minFilter == GL_NEAREST_MIPMAP_NEAREST || minFilter == GL_NEAREST_MIPMAP_LINEAR) ? GL_NEAREST : GL_LINEAR;
+
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, sampler.wrapS);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, sampler.wrapT);
+
+    if (sampler.anisotropy > 1.f && hasMipmaps)
+    {
+        GLfloat maxAnisotropy = MaxAnisotropy();
+        if (maxAnisotropy > 1.f)
+            glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, sampler.anisotropy < maxAnisotropy ? sampler.anisotropy : maxAnisotropy);
+    }
+}
+
+// Returns whether a baked file exists, in the asset pack or next to
+// the source. 'header' is null when it is stale or invalid. Level
+// data follows the header and lives as long as the pack or 'file'.
+static bool OpenBakedTexture(const char * bitmap_file, MappedFile &file, const BakedTextureHeader *&header)
+{
+    std::string path = BakedTexturePath(bitmap_file);
+
+    const unsigned char *data;
+    size_t size;
+    if (!AssetPack::Find(path.c_str(), data, size))
+    {
+        if (!file.Open(path.c_str()))
+            return 0;
+
+        data = file.Data();
+        size = file.Size();
+    }
+
+    header = ValidateBakedTexture(data, size, bitmap_file);
+    return 1;
+}
+
+static const unsigned char* BakedLevel(const BakedTextureHeader *header, unsigned int level)
+{
+    return (const unsigned char*)header + header->levelOffset[level];
+}
+
+DecodedImage DecodeTexture(const char * bitmap_file)
+{
+    PROFILE_ZONE("DecodeTexture");
+
+    DecodedImage image;
+    image.channels = 0;
+
+    // Decoded straight from the pack's mapping when it has the file
+    const unsigned char *data;
+    size_t size;
+    if (AssetPack::Find(bitmap_file, data, size))
+        image.pixels = stbi_load_from_memory(data, size, &image.width, &image.height, &image.channels, 0);
+    else
+        image.pixels = stbi_load( bitmap_file, &image.width, &image.height, &image.channels, 0);
+
+    return image;
+}
+
+// Layers of an RGBA array that need levels built are widened first
+static void ExpandToRGBA(const DecodedImage &image, unsigned char *rgba)
+{
+    size_t count = (size_t)image.width * image.height;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const unsigned char *p = image.pixels + i * image.channels;
+        if (image.channels >= 3)
+        {
+            rgba[i * 4 + 0] = p[0];
+            rgba[i * 4 + 1] = p[1];
+            rgba[i * 4 + 2] = p[2];
+            rgba[i * 4 + 3] = image.channels == 4 ? p[3] : 255;
+        }
+        else
+        {
+            rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = p[0];
+            rgba[i * 4 + 3] = image.channels == 2 ? p[1] : 255;
+        }
+    }
+}
+
+// Opens the baked layers and checks every layer has pixels of the
+// same size. On failure, frees the decoded images.
+static bool CheckTextureLayers(const char * const * bitmap_files, DecodedImage *images, unsigned int layers,
+    std::vector<std::unique_ptr<MappedFile>> &baked, std::vector<const BakedTextureHeader*> &headers, int &width, int &height)
+{
+    width = height = 0;
+    bool failed = false;
+    for (unsigned int i = 0; i < layers; ++i)
+    {
+        int layerWidth, layerHeight;
+        baked[i].reset(new MappedFile());
+        if (OpenBakedTexture(bitmap_files[i], *baked[i], headers[i]) && headers[i])
+        {
+            layerWidth = headers[i]->width;
+            layerHeight = headers[i]->height;
+        }
+        else if (images[i].channels)
+        {
+            layerWidth = images[i].width;
+            layerHeight = images[i].height;
+        }
+        else
+        {
+            LOG_ERROR("%s: error loading bitmap file", bitmap_files[i]);
+            failed = true;
+            continue;
+        }
+
+        if (!width)
+        {
+            width = layerWidth;
+            height = layerHeight;
+        }
+        else if (layerWidth != width || layerHeight != height)
+        {
+            LOG_ERROR("%s: %dx%d does not match the other layers (%dx%d)", bitmap_files[i], layerWidth, layerHeight, width, height);
+            failed = true;
+        }
+    }
+
+    if (failed)
+    {
+        for (unsigned int i = 0; i < layers; ++i)
+        {
+            stbi_image_free(images[i].pixels);
+            images[i].pixels = nullptr;
+        }
+    }
+
+    return !failed;
+}
+
+// Full chain down to 1x1 when the sampler wants mipmaps
+static unsigned int TextureLevels(int width, int height, const TextureSampler &sampler)
+{
+    unsigned int levels = 1;
+    if (sampler.mipmaps)
+        while (((width > height ? width : height) >> levels) && levels < BAKED_TEXTURE_MAX_LEVELS)
+            ++levels;
+    return levels;
+}
+
+// Every level of every layer, as uploads into 'request'. Baked levels
+// come straight from their mapping. Whatever a layer has no baked level
+// for is built on the CPU with the baker's filter, so one unbaked layer
+// never makes the driver regenerate (and overwrite) the baked chains
+// of the others. Frees the decoded images or hands them to 'request'.
+static void BuildTextureUploads(DecodedImage *images, std::vector<std::unique_ptr<MappedFile>> &baked,
+    const std::vector<const BakedTextureHeader*> &headers, StreamRequest &request)
+{
+    int width = request.width, height = request.height;
+    for (unsigned int i = 0; i < request.layers; ++i)
+    {
+        TextureUpload upload;
+        upload.layer = i;
+        upload.channels = 4;
+
+        unsigned int level = 0;
+        if (headers[i])
+        {
+            unsigned int bakedLevels = headers[i]->levels < request.levels ? headers[i]->levels : request.levels;
+            for (; level < bakedLevels; ++level)
+            {
+                upload.pixels = BakedLevel(headers[i], level);
+                upload.width = width >> level ? width >> level : 1;
+                upload.height = height >> level ? height >> level : 1;
+                upload.level = level;
+                request.uploads.push_back(upload);
+            }
+
+            if (baked[i]->IsOpen())
+                request.mappings.push_back(std::move(baked[i]));
+        }
+
+        // Level 0 as decoded, when nothing has to be built from it
+        else if (images[i].channels == 4 && request.levels == 1)
+        {
+            upload.pixels = images[i].pixels;
+            upload.width = width;
+            upload.height = height;
+            upload.level = 0;
+            request.uploads.push_back(upload);
+
+            request.images.push_back(images[i]);
+            images[i].pixels = nullptr;
+            continue;
+        }
+
+        else
+        {
+            request.generated.push_back(std::vector<unsigned char>((size_t)width * height * 4));
+            ExpandToRGBA(images[i], &request.generated.back()[0]);
+            stbi_image_free(images[i].pixels);
+            images[i].pixels = nullptr;
+
+            upload.pixels = &request.generated.back()[0];
+            upload.width = width;
+            upload.height = height;
+            upload.level = 0;
+            request.uploads.push_back(upload);
+            level = 1;
+        }
+
+        for (; level < request.levels; ++level)
+        {
+            const TextureUpload &above = request.uploads.back();
+            upload.width = width >> level ? width >> level : 1;
+            upload.height = height >> level ? height >> level : 1;
+            upload.level = level;
+
+            request.generated.push_back(std::vector<unsigned char>((size_t)upload.width * upload.height * 4));
+            upload.pixels = &request.generated.back()[0];
+            DownsampleTexture(above.pixels, above.width, above.height, &request.generated.back()[0], upload.width, upload.height);
+            request.uploads.push_back(upload);
+        }
     }
+}
+
+bool PrepareTextureArray(const char * const * bitmap_files, DecodedImage *images, unsigned int layers, const TextureSampler &sampler,
+    StreamRequest &request)
+{
+    PROFILE_ZONE("PrepareTextureArray");
+
+    std::vector<std::unique_ptr<MappedFile>> baked(layers);
+    std::vector<const BakedTextureHeader*> headers(layers, nullptr);
 
-    glEnable(GL_TEXTURE_2D);
+    if (!CheckTextureLayers(bitmap_files, images, layers, baked, headers, request.width, request.height))
+        return 0;
+
+    request.layers = layers;
+    request.levels = TextureLevels(request.width, request.height, sampler);
+    BuildTextureUploads(images, baked, headers, request);
+    return 1;
+}
+
+// Storage for every level, contents undefined. Leaves it bound.
+static GLuint AllocateTextureArray(int width, int height, unsigned int layers, unsigned int levels, const TextureSampler &sampler)
+{
+    GLuint texture = 0;
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+    for (unsigned int level = 0; level < levels; ++level)
+    {
+        GLsizei levelWidth = width >> level ? width >> level : 1;
+        GLsizei levelHeight = height >> level ? height >> level : 1;
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, levelWidth, levelHeight, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
 
-    stbi_image_free(data);
-    printf("Texture loaded. Width is %d\n", width);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    ApplySampler(GL_TEXTURE_2D_ARRAY, sampler, levels > 1);
 
     return texture;
 }
+
+GLuint UploadTextureArray(StreamRequest &request, const TextureSampler &sampler)
+{
+    PROFILE_ZONE("UploadTextureArray");
+
+    if (!request.layers)
+        return -1;
+
+    GLuint texture = AllocateTextureArray(request.width, request.height, request.layers, request.levels, sampler);
+    for (const TextureUpload &upload : request.uploads)
+    {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, 0, upload.layer, upload.width, upload.height, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, upload.pixels);
+    }
+
+    for (DecodedImage &image : request.images)
+        stbi_image_free(image.pixels);
+    request.images.clear();
+
+    LOG_DEBUG("Texture array loaded. %d x %d, %u layers", request.width, request.height, request.layers);
+
+    return texture;
+}
+
+GLuint StreamTextureArray(StreamRequest &request, const TextureSampler &sampler, TextureStreamer &streamer, unsigned int &ticket)
+{
+    PROFILE_ZONE("StreamTextureArray");
+
+    if (!request.layers)
+        return -1;
+
+    request.texture = AllocateTextureArray(request.width, request.height, request.layers, request.levels, sampler);
+    LOG_DEBUG("Streaming texture array. %d x %d, %u layers", request.width, request.height, request.layers);
+
+    GLuint texture = request.texture;
+    ticket = streamer.Submit(request);
+    return texture;
+}
+
+bool HasBakedTexture(const char * bitmap_file)
+{
+    MappedFile file;
+    const BakedTextureHeader *header;
+    return OpenBakedTexture(bitmap_file, file, header) && header;
+}
@@ -0,0 +1,273 @@
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <chrono>
+
+#include <TextureResidency.h>
+#include <TextureLoader.h>
+#include <Profiler.h>
+#include <Logger.h>
+
+#include "stb_image.h"
+
+// Two full screen images would not fit together, gameplay textures always do
+#define DEFAULT_TEXTURE_BUDGET (32u << 20)
+
+// Decodes whatever has no baked file, those are mapped, and lists
+// the uploads. Empty when the set cannot be loaded.
+static StreamRequest PrepareSet(const std::vector<const char*> &paths, const TextureSampler &sampler)
+{
+	std::vector<DecodedImage> images(paths.size());
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		if (HasBakedTexture(paths[i]))
+		{
+			images[i].pixels = nullptr;
+			images[i].channels = 0;
+		}
+		else
+			images[i] = DecodeTexture(paths[i]);
+	}
+
+	StreamRequest request;
+	PrepareTextureArray(&paths[0], &images[0], paths.size(), sampler, request);
+	return request;
+}
+
+// What the driver holds for a 2D array, mip chain included
+static size_t TextureArrayBytes(GLuint texture)
+{
+	GLint width = 0, height = 0, layers = 0, maxLevel = 0;
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_HEIGHT, &height);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_DEPTH, &layers);
+	glGetTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+	size_t bytes = 0;
+	for (GLint level = 0; level <= maxLevel && level < 16; ++level)
+	{
+		size_t levelWidth = width >> level ? width >> level : 1;
+		size_t levelHeight = height >> level ? height >> level : 1;
+		bytes += levelWidth * levelHeight * 4 * layers;
+	}
+	return bytes;
+}
+
+TextureResidency::TextureResidency() : decoder("TexturePrefetch")
+{
+	budget = DEFAULT_TEXTURE_BUDGET;
+	residentBytes = 0;
+	useClock = 0;
+	frame = 0;
+}
+
+TextureResidency::~TextureResidency()
+{
+	// GL textures die with the context, only decoded pixels are ours
+	for (TextureSet &set : sets)
+	{
+		if (!set.pending.valid())
+			continue;
+
+		for (DecodedImage &image : set.pending.get().images)
+			stbi_image_free(image.pixels);
+	}
+}
+
+unsigned int TextureResidency::Register(const char * const *paths, unsigned int count, const TextureSampler &sampler)
+{
+	TextureSet set;
+	set.paths.assign(paths, paths + count);
+	set.sampler = sampler;
+	set.texture = 0;
+	set.bytes = 0;
+	set.lastUsed = 0;
+	set.lastUsedFrame = 0;
+	set.prefetched = false;
+	set.streaming = false;
+	set.ticket = 0;
+
+	sets.push_back(std::move(set));
+	return sets.size() - 1;
+}
+
+///
+/// Loading
+///
+void TextureResidency::Prefetch(unsigned int id)
+{
+	TextureSet &set = sets[id];
+	if (set.texture || set.pending.valid())
+		return;
+
+	LOG_DEBUG("Prefetching %s", set.paths[0]);
+	set.prefetched = true;
+
+	std::vector<const char*> paths = set.paths;
+	TextureSampler sampler = set.sampler;
+	set.pending = decoder.Push([paths, sampler]()
+	{
+		PROFILE_ZONE("PrefetchTextures");
+		return PrepareSet(paths, sampler);
+	});
+}
+
+void TextureResidency::Load(unsigned int id)
+{
+	PROFILE_ZONE("LoadTextureSet");
+
+	TextureSet &set = sets[id];
+
+	StreamRequest request;
+	if (set.pending.valid())
+	{
+		PROFILE_ZONE("WaitPrefetch");
+		request = set.pending.get();
+	}
+	else
+		request = PrepareSet(set.paths, set.sampler);
+
+	set.texture = UploadTextureArray(request, set.sampler);
+	if (set.texture == (GLuint)-1)
+	{
+		// Stays 0-sized, Acquire() keeps returning the failed id
+		set.bytes = 0;
+		return;
+	}
+
+	set.bytes = TextureArrayBytes(set.texture);
+	residentBytes += set.bytes;
+
+	LOG_DEBUG("Texture set %s resident, %.1f MB (%.1f MB total)", set.paths[0], set.bytes / 1048576.0, residentBytes / 1048576.0);
+}
+
+// Storage is allocated now and counts against the budget right away.
+// Runs during gameplay, so everything that allocates was done by the
+// worker already.
+void TextureResidency::StartStreaming(unsigned int id)
+{
+	PROFILE_ZONE("StartStreaming");
+
+	TextureSet &set = sets[id];
+	StreamRequest request = set.pending.get();
+
+	set.texture = StreamTextureArray(request, set.sampler, streamer, set.ticket);
+	if (set.texture == (GLuint)-1)
+	{
+		set.bytes = 0;
+		return;
+	}
+
+	set.streaming = true;
+	set.bytes = TextureArrayBytes(set.texture);
+	residentBytes += set.bytes;
+}
+
+void TextureResidency::Update()
+{
+	PROFILE_ZONE("TextureResidencyUpdate");
+	++frame;
+
+	for (unsigned int i = 0; i < sets.size(); ++i)
+	{
+		TextureSet &set = sets[i];
+		if (!set.texture && set.pending.valid()
+			&& set.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			StartStreaming(i);
+	}
+
+	streamer.Pump(STREAM_SLOT_BYTES);
+
+	for (TextureSet &set : sets)
+	{
+		if (set.streaming && streamer.Done(set.ticket))
+		{
+			set.streaming = false;
+			LOG_DEBUG("Texture set %s streamed in, %.1f MB (%.1f MB total)", set.paths[0], set.bytes / 1048576.0, residentBytes / 1048576.0);
+		}
+	}
+
+	EnforceBudget();
+}
+
+GLuint TextureResidency::Acquire(unsigned int id)
+{
+	TextureSet &set = sets[id];
+	set.lastUsed = ++useClock;
+	set.lastUsedFrame = frame;
+	set.prefetched = false;
+
+	if (set.streaming)
+	{
+		// Acquired before it finished streaming, complete it now
+		PROFILE_ZONE("FinishStreaming");
+		streamer.Finish(set.ticket);
+		set.streaming = false;
+	}
+	else if (!set.texture)
+	{
+		Load(id);
+		EnforceBudget();
+	}
+
+	return set.texture;
+}
+
+///
+/// Eviction
+///
+void TextureResidency::Evict(unsigned int id)
+{
+	TextureSet &set = sets[id];
+	if (!set.texture)
+		return;
+
+	if (set.texture != (GLuint)-1)
+		glDeleteTextures(1, &set.texture);
+
+	residentBytes -= set.bytes;
+	set.texture = 0;
+	set.bytes = 0;
+
+	LOG_DEBUG("Texture set %s evicted (%.1f MB resident)", set.paths[0], residentBytes / 1048576.0);
+}
+
+// Least recently used first. Sets drawn this frame or the last one,
+// still streaming, or prefetched and not drawn yet are kept, even if
+// that leaves the budget exceeded for a while.
+void TextureResidency::EnforceBudget()
+{
+	while (residentBytes > budget)
+	{
+		int oldest = -1;
+		for (unsigned int i = 0; i < sets.size(); ++i)
+		{
+			const TextureSet &set = sets[i];
+			if (!set.texture || set.streaming || set.prefetched || set.lastUsedFrame + 1 >= frame)
+				continue;
+
+			if (oldest < 0 || sets[i].lastUsed < sets[oldest].lastUsed)
+				oldest = i;
+		}
+
+		if (oldest < 0)
+			break;
+
+		Evict(oldest);
+	}
+}
+
+void TextureResidency::SetBudget(size_t bytes)
+{
+	budget = bytes;
+}
+
+size_t TextureResidency::ResidentBytes() const
+{
+	return residentBytes;
+}
+
+bool TextureResidency::IsResident(unsigned int id) const
+{
+	return sets[id].texture != 0;
+}
@@ -0,0 +1,329 @@
+#define GL_GLEXT_PROTOTYPES 1
+
+#include <string.h>
+
+#include <TextureStreamer.h>
+#include <Profiler.h>
+#include <RenderMetrics.h>
+
+#include "stb_image.h"
+
+// Worker side: rows into the mapped buffer, widened to RGBA
+static void CopyRows(unsigned char *dst, TextureUpload upload, int firstRow, int rows)
+{
+	PROFILE_ZONE("StreamCopy");
+
+	size_t pixels = (size_t)upload.width * rows;
+	const unsigned char *src = upload.pixels + (size_t)firstRow * upload.width * upload.channels;
+
+	if (upload.channels == 4)
+	{
+		memcpy(dst, src, pixels * 4);
+		return;
+	}
+
+	for (size_t i = 0; i < pixels; ++i)
+	{
+		const unsigned char *p = src + i * upload.channels;
+		if (upload.channels >= 3)
+		{
+			dst[i * 4 + 0] = p[0];
+			dst[i * 4 + 1] = p[1];
+			dst[i * 4 + 2] = p[2];
+			dst[i * 4 + 3] = 255;
+		}
+		else
+		{
+			dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = p[0];
+			dst[i * 4 + 3] = upload.channels == 2 ? p[1] : 255;
+		}
+	}
+}
+
+StreamRequest::StreamRequest()
+{
+	texture = 0;
+	width = height = 0;
+	layers = levels = 0;
+}
+
+TextureStreamer::TextureStreamer()
+{
+	nextTicket = 1;
+	initialized = false;
+	stopping = false;
+	active.reserve(STREAM_REQUESTS_RESERVED);
+
+	for (Slot &slot : slots)
+	{
+		slot.buffer = 0;
+		slot.capacity = 0;
+		slot.mapped = nullptr;
+		slot.fence = 0;
+		slot.copy = COPY_NONE;
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// The GL context is gone by now, only let the copies still
+	// queued finish and free what they read from
+	if (copier.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		queued.notify_one();
+		copier.join();
+	}
+
+	for (Active &a : active)
+		Release(a);
+}
+
+unsigned int TextureStreamer::Submit(StreamRequest &request)
+{
+	active.push_back(Active());
+	Active &a = active.back();
+	a.ticket = nextTicket++;
+	a.request = std::move(request);
+	a.nextUpload = 0;
+	a.nextRow = 0;
+	a.copying = 0;
+
+	return a.ticket;
+}
+
+TextureStreamer::Active* TextureStreamer::Find(unsigned int ticket)
+{
+	for (Active &a : active)
+		if (a.ticket == ticket)
+			return &a;
+
+	return nullptr;
+}
+
+bool TextureStreamer::Done(unsigned int ticket)
+{
+	return ticket < nextTicket && !Find(ticket);
+}
+
+void TextureStreamer::Release(Active &a)
+{
+	for (DecodedImage &image : a.request.images)
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = nullptr;
+	}
+	a.request.generated.clear();
+	a.request.mappings.clear();
+}
+
+///
+/// Copy thread
+///
+void TextureStreamer::CopyLoop()
+{
+	Profiler::SetThreadName("TextureCopy");
+
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		Slot *next = nullptr;
+		queued.wait(lock, [&]()
+		{
+			for (Slot &slot : slots)
+			{
+				if (slot.copy == COPY_QUEUED)
+				{
+					next = &slot;
+					return true;
+				}
+			}
+			return stopping;
+		});
+
+		if (!next)
+			return;
+
+		next->copy = COPY_RUNNING;
+		lock.unlock();
+
+		CopyRows(next->mapped, next->upload, next->firstRow, next->rows);
+
+		lock.lock();
+		next->copy = COPY_DONE;
+		copied.notify_all();
+	}
+}
+
+///
+/// GL thread
+///
+
+// Maps a free slot and queues a copy of the next rows of 'a'.
+// Returns how many bytes that is.
+size_t TextureStreamer::StartCopy(Slot &slot, Active &a)
+{
+	const TextureUpload &upload = a.request.uploads[a.nextUpload];
+	size_t rowBytes = (size_t)upload.width * 4;
+	int rows = STREAM_SLOT_BYTES / rowBytes;
+	if (rows < 1)
+		rows = 1;
+	if (rows > upload.height - a.nextRow)
+		rows = upload.height - a.nextRow;
+
+	size_t bytes = rowBytes * rows;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+	if (slot.capacity < bytes)
+	{
+		slot.capacity = bytes > STREAM_SLOT_BYTES ? bytes : STREAM_SLOT_BYTES;
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, slot.capacity, nullptr, GL_STREAM_DRAW);
+	}
+
+	// Its fence already passed, so nothing on the GPU still reads it
+	slot.mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	if (slot.mapped)
+	{
+		slot.ticket = a.ticket;
+		slot.upload = upload;
+		slot.firstRow = a.nextRow;
+		slot.rows = rows;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			slot.copy = COPY_QUEUED;
+		}
+		queued.notify_one();
+		++a.copying;
+	}
+	else
+	{
+		// Could not map: these rows go up from client memory instead
+		std::vector<unsigned char> pixels(bytes);
+		CopyRows(&pixels[0], upload, a.nextRow, rows);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, a.request.texture);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, a.nextRow, upload.layer,
+			upload.width, rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+		RenderMetrics::Add(RENDER_TEXTURE_BINDS);
+	}
+
+	a.nextRow += rows;
+	if (a.nextRow >= upload.height)
+	{
+		++a.nextUpload;
+		a.nextRow = 0;
+	}
+
+	RenderMetrics::Add(RENDER_BUFFER_BYTES, bytes);
+	return bytes;
+}
+
+// The copy is done: the rows go from the buffer into the texture
+void TextureStreamer::FinishCopy(Slot &slot)
+{
+	slot.copy = COPY_NONE;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	slot.mapped = nullptr;
+
+	Active *a = Find(slot.ticket);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, a->request.texture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, slot.upload.level, 0, slot.firstRow, slot.upload.layer,
+		slot.upload.width, slot.rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	RenderMetrics::Add(RENDER_TEXTURE_BINDS);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	--a->copying;
+}
+
+void TextureStreamer::Pump(size_t maxBytes, bool wait)
+{
+	if (active.empty() && !initialized)
+		return;
+
+	PROFILE_ZONE("StreamTextures");
+
+	if (!initialized)
+	{
+		GLuint buffers[STREAM_SLOTS];
+		glGenBuffers(STREAM_SLOTS, buffers);
+		for (int i = 0; i < STREAM_SLOTS; ++i)
+			slots[i].buffer = buffers[i];
+		copier = std::thread(&TextureStreamer::CopyLoop, this);
+		initialized = true;
+	}
+
+	for (Slot &slot : slots)
+	{
+		// Copies that finished
+		bool done;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (wait)
+				copied.wait(lock, [&]() { return slot.copy == COPY_NONE || slot.copy == COPY_DONE; });
+			done = slot.copy == COPY_DONE;
+		}
+		if (done)
+			FinishCopy(slot);
+
+		// Buffers the GPU is done reading
+		if (slot.fence)
+		{
+			GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+			if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+			{
+				glDeleteSync(slot.fence);
+				slot.fence = 0;
+			}
+		}
+	}
+
+	// New copies, oldest request first. Only this thread moves
+	// slots out of COPY_NONE.
+	size_t started = 0;
+	for (Active &a : active)
+	{
+		for (Slot &slot : slots)
+		{
+			if (started >= maxBytes || a.nextUpload >= a.request.uploads.size())
+				break;
+
+			if (slot.copy != COPY_NONE || slot.fence)
+				continue;
+
+			started += StartCopy(slot, a);
+		}
+	}
+
+	// Requests with every row in their texture
+	for (size_t i = 0; i < active.size(); )
+	{
+		Active &a = active[i];
+		if (a.nextUpload < a.request.uploads.size() || a.copying)
+		{
+			++i;
+			continue;
+		}
+
+		Release(a);
+		active.erase(active.begin() + i);
+	}
+
+	// Never leave a pixel buffer bound, other uploads would read from it
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::Finish(unsigned int ticket)
+{
+	PROFILE_ZONE("FinishStream");
+
+	while (!Done(ticket))
+		Pump((size_t)-1, true);
+}
@@ -0,0 +1,21 @@
+#include <Tunnel.h>
+
+// A gap in each lane, then every other lane open
+const LaneMask TunnelPatterns<4>::blocked[] = {
+	0x7, 0xb, 0xd, 0xe,
+	0x5, 0xa
+};
+
+// The original hexagon's, in their original order
+const LaneMask TunnelPatterns<6>::blocked[] = {
+	0x1f, 0x2f, 0x37, 0x3b, 0x3d, 0x3e,
+	0x15, 0x2a,
+	0x1d, 0x2e, 0x17
+};
+
+// A gap in each lane, every other lane open, then pairs of opposite gaps
+const LaneMask TunnelPatterns<8>::blocked[] = {
+	0x7f, 0xbf, 0xdf, 0xef, 0xf7, 0xfb, 0xfd, 0xfe,
+	0x55, 0xaa,
+	0xee, 0xdd, 0xbb, 0x77
+};
@@ -0,0 +1,57 @@
+#include <WorkQueue.h>
+#include <Profiler.h>
+
+WorkQueue::WorkQueue(const char* n, unsigned int count)
+{
+	name = n;
+	threadCount = count ? count : 1;
+	stopping = false;
+}
+
+WorkQueue::~WorkQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread &thread : threads)
+		thread.join();
+}
+
+void WorkQueue::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+
+		if (threads.empty())
+		{
+			for (unsigned int i = 0; i < threadCount; ++i)
+				threads.push_back(std::thread(&WorkQueue::WorkerLoop, this));
+		}
+	}
+	wake.notify_one();
+}
+
+void WorkQueue::WorkerLoop()
+{
+	Profiler::SetThreadName(name);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		wake.wait(lock, [this]() { return !jobs.empty() || stopping; });
+		if (jobs.empty())
+			return;
+
+		std::function<void()> job = std::move(jobs.front());
+		jobs.pop_front();
+		lock.unlock();
+
+		job();
+
+		lock.lock();
+	}
+}
@@ -3,9 +3,10 @@
 int main(int argc, char *argv[])
 {
     Engine gameEngine;
-    if (gameEngine.Initialize(argc, argv))
-    	gameEngine.GameLoop();
+    bool ok = gameEngine.Initialize(argc, argv) && gameEngine.GameLoop();
 
-    gameEngine.Shutdown();
-    return 0;
+    // Non-zero when a headless replay did not match its recording,
+    // or when a TRACK_ALLOCS build saw gameplay frames allocate
+    bool clean = gameEngine.Shutdown();
+    return ok && clean ? 0 : 1;
 }
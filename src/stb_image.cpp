@@ -1,2 +1,11 @@
 #define STB_IMAGE_IMPLEMENTATION
+
+// Route stb_image's heap use through the allocation tracker
+#ifdef TRACK_ALLOCS
+#include <AllocTracker.h>
+#define STBI_MALLOC(size) TrackedMalloc(size)
+#define STBI_REALLOC(ptr, size) TrackedRealloc(ptr, size)
+#define STBI_FREE(ptr) TrackedFree(ptr)
+#endif
+
 #include "stb_image.h"
\ No newline at end of file
@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <string>
+
+#include <BakedTexture.h>
+
+///
+/// Offline texture baker: writes <image>.istx next to every image given
+///
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s image...\n", argv[0]);
+		return 1;
+	}
+
+	int failed = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string error;
+		if (BakeTexture(argv[i], error))
+			printf("Baked %s -> %s\n", argv[i], BakedTexturePath(argv[i]).c_str());
+		else
+		{
+			fprintf(stderr, "%s: %s\n", argv[i], error.c_str());
+			failed = 1;
+		}
+	}
+
+	return failed;
+}
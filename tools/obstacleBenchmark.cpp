@@ -0,0 +1,153 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <ObstacleTrack.h>
+#include <Simulation.h>
+
+// Per tick, as on Easy
+#define BENCH_SPEED 9
+
+// Distance ahead that gets drawn
+#define BENCH_FAR_PLANE (100 * FIXED_ONE)
+
+// Longest track that fits positions, in thousandths of a unit
+#define BENCH_TRACK_LENGTH 100000000
+
+struct BenchResult
+{
+	double nsPerTick;
+	uint64_t hits, drawn;
+};
+
+static double Since(std::chrono::steady_clock::time_point start, unsigned int ticks)
+{
+	std::chrono::duration<double, std::nano> took = std::chrono::steady_clock::now() - start;
+	return took.count() / ticks;
+}
+
+///
+/// How Simulation did it before: every obstacle moves every tick, and
+/// every one is looked at for collisions and drawing
+///
+struct ScanObstacle
+{
+	LaneMask blocked;
+	Fixed distance;
+};
+
+static BenchResult Scan(const std::vector<ScanObstacle> &field, unsigned int ticks)
+{
+	std::vector<ScanObstacle> obstacles(field);
+	BenchResult result = { 0, 0, 0 };
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int t = 0; t < ticks; ++t)
+	{
+		for (size_t n = 0; n < obstacles.size(); )
+		{
+			ScanObstacle &o = obstacles[n];
+			o.distance -= BENCH_SPEED;
+
+			if (o.distance < SIM_PASSED)
+			{
+				obstacles.erase(obstacles.begin() + n);
+				continue;
+			}
+
+			if (o.distance < SIM_COLLIDES && (o.blocked & 1))
+				++result.hits;
+
+			++n;
+		}
+
+		for (const ScanObstacle &o : obstacles)
+		{
+			if (o.distance < BENCH_FAR_PLANE)
+				++result.drawn;
+		}
+	}
+	result.nsPerTick = Since(start, ticks);
+
+	return result;
+}
+
+static BenchResult Track(const std::vector<ScanObstacle> &field, unsigned int ticks)
+{
+	ObstacleTrack track;
+	track.Reserve(field.size());
+	for (const ScanObstacle &o : field)
+		track.Add(o.blocked, o.distance);
+
+	BenchResult result = { 0, 0, 0 };
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int t = 0; t < ticks; ++t)
+	{
+		track.Advance(BENCH_SPEED);
+
+		for (const Obstacle &o : track.Colliding())
+		{
+			if (o.blocked & 1)
+				++result.hits;
+		}
+
+		result.drawn += track.Within(SIM_PASSED, BENCH_FAR_PLANE).size();
+	}
+	result.nsPerTick = Since(start, ticks);
+
+	return result;
+}
+
+///
+/// Moves through fields of 100 to 1M obstacles, the old way and with
+/// ObstacleTrack, and compares the time per tick
+///
+int main(int argc, char *argv[])
+{
+	unsigned int sizes[] = { 100, 10000, 1000000 };
+
+	// Enough ticks for each run to take a while, fewer for big fields
+	uint64_t work = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000000;
+
+	printf("%10s %8s %10s %16s %16s %9s\n", "obstacles", "spacing", "ticks", "scan ns/tick", "track ns/tick", "speedup");
+
+	for (unsigned int size : sizes)
+	{
+		// Game spacing where it fits, denser fields beyond that
+		Fixed spacing = BENCH_TRACK_LENGTH / size;
+		if (spacing > 11 * FIXED_ONE)
+			spacing = 11 * FIXED_ONE;
+
+		std::vector<ScanObstacle> field(size);
+		uint32_t random = 1;
+		for (unsigned int i = 0; i < size; ++i)
+		{
+			field[i].blocked = Simulation::NextRandom(random) & 0x3f;
+			field[i].distance = 16 * FIXED_ONE + i * spacing;
+		}
+
+		uint64_t ticks = work / size;
+		if (ticks < 100)
+			ticks = 100;
+		if (ticks > 100000)
+			ticks = 100000;
+
+		BenchResult scan = Scan(field, ticks);
+		BenchResult track = Track(field, ticks);
+
+		if (scan.hits != track.hits || scan.drawn != track.drawn)
+		{
+			fprintf(stderr, "Results differ at %u obstacles: %llu/%llu hits, %llu/%llu drawn\n", size,
+				(unsigned long long)scan.hits, (unsigned long long)track.hits,
+				(unsigned long long)scan.drawn, (unsigned long long)track.drawn);
+			return 1;
+		}
+
+		printf("%10u %8.3f %10llu %16.1f %16.1f %8.0fx\n", size, FixedToFloat(spacing), (unsigned long long)ticks,
+			scan.nsPerTick, track.nsPerTick, track.nsPerTick > 0 ? scan.nsPerTick / track.nsPerTick : 0.0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <AssetPack.h>
+
+///
+/// Offline asset packer: packs every file given into one pack,
+/// indexed by the path as given
+///
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s pack file...\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> files(argv + 2, argv + argc);
+
+	std::string error;
+	if (!AssetPack::Build(argv[1], files, error))
+	{
+		fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+		return 1;
+	}
+
+	printf("Packed %zu files into %s\n", files.size(), argv[1]);
+	return 0;
+}
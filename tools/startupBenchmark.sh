@@ -0,0 +1,58 @@
+#!/bin/bash
+# Launches the game RUNS times with cold caches and RUNS times with warm
+# ones, each with --startup-benchmark (hidden window, quits after the
+# first menu frame), and prints the distribution of every startup phase.
+#
+# Cold runs delete the shader program cache and, when permitted, drop
+# the OS page cache. Run from the repository root, where res/ is.
+#
+# Usage: tools/startupBenchmark.sh <game binary> [runs]
+
+BIN=${1:?usage: $0 <game binary> [runs]}
+RUNS=${2:-10}
+CSV=startup.csv
+SHADER_CACHE="$(dirname "$BIN")/shadercache"
+
+# No audio device or display needed
+export SDL_AUDIODRIVER=${SDL_AUDIODRIVER:-dummy}
+LAUNCH=()
+if [ -z "$DISPLAY" ] && [ -z "$WAYLAND_DISPLAY" ] && command -v xvfb-run > /dev/null; then
+	LAUNCH=(xvfb-run -a)
+fi
+
+drop_caches()
+{
+	rm -rf "$SHADER_CACHE"
+	sync
+	if [ -w /proc/sys/vm/drop_caches ]; then
+		echo 3 > /proc/sys/vm/drop_caches
+	elif [ -z "$WARNED" ]; then
+		echo "Cannot drop the page cache (needs root), cold runs only miss the shader cache" >&2
+		WARNED=1
+	fi
+}
+
+rm -f "$CSV"
+
+for ((i = 0; i < RUNS; ++i)); do
+	drop_caches
+	"${LAUNCH[@]}" "$BIN" --startup-benchmark cold > /dev/null || exit 1
+done
+
+for ((i = 0; i < RUNS; ++i)); do
+	"${LAUNCH[@]}" "$BIN" --startup-benchmark warm > /dev/null || exit 1
+done
+
+# label,phase,start_ms,duration_ms -> min / median / p90 / max per phase
+sort -t, -k1,1 -k2,2 -k4,4n "$CSV" | awk -F, '
+function flush()
+{
+	if (n)
+		printf "%-5s %-20s %4d %9.1f %9.1f %9.1f %9.1f\n", label, phase, n,
+			v[1], v[int((n + 1) / 2)], v[int((n * 9 + 9) / 10)], v[n]
+	n = 0
+}
+BEGIN { printf "%-5s %-20s %4s %9s %9s %9s %9s\n", "run", "phase", "n", "min", "median", "p90", "max" }
+$1 != label || $2 != phase { flush(); label = $1; phase = $2 }
+{ v[++n] = $4 }
+END { flush() }'